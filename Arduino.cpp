@@ -1,5 +1,7 @@
 #include "Arduino.h"
 #include "SITLSocket.h"
+#include "MockWorld.h"
+#include "FlightRecorder.h"
 #include <iostream>
 #include <map>
 
@@ -7,9 +9,15 @@ const uint64_t start = std::chrono::duration_cast<std::chrono::milliseconds>(std
 const uint64_t startMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 uint64_t fakeMillis = 0;
 bool useFakeMillis = false;
+static uint64_t fakeSubMillisMicros = 0;  // micros() resolution below fakeMillis
+static bool virtualDelays = false;        // delay() advances the fake clock instead of sleeping
 
 uint64_t millis()
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        return world->millis();
+    }
     if (useFakeMillis)
     {
         return fakeMillis;
@@ -19,35 +27,106 @@ uint64_t millis()
 
 uint64_t micros()
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        return world->micros();
+    }
     if (useFakeMillis)
     {
-        return fakeMillis * 1000;
+        return fakeMillis * 1000 + fakeSubMillisMicros;
     }
     return (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() - startMicros);
 }
 
 void setMillis(uint64_t ms)
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->setMicros(ms * 1000);
+        return;
+    }
     fakeMillis = ms;
+    fakeSubMillisMicros = 0;
     useFakeMillis = true;
 }
 
+void setMicros(uint64_t us)
+{
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->setMicros(us);
+        return;
+    }
+    fakeMillis = us / 1000;
+    fakeSubMillisMicros = us % 1000;
+    useFakeMillis = true;
+}
+
+void advanceMicros(uint64_t us)
+{
+    setMicros(micros() + us);
+}
+
+void setVirtualTime(bool enabled)
+{
+    if (enabled && !useFakeMillis)
+    {
+        setMicros(micros());
+    }
+    virtualDelays = enabled;
+}
+
+bool fakeClockActive()
+{
+    return MockWorld::current() != nullptr || useFakeMillis;
+}
+
 void resetMillis()
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->setMicros(0);
+        return;
+    }
     fakeMillis = 0;
+    fakeSubMillisMicros = 0;
     useFakeMillis = false;
+    virtualDelays = false;
 }
 
 #ifndef WIN32
 void Sleep(long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
 #endif
 
-void delay(unsigned long ms) { Sleep(ms); }
+void delay(unsigned long ms)
+{
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->advanceMicros((uint64_t)ms * 1000);
+        return;
+    }
+    if (virtualDelays)
+    {
+        advanceMicros((uint64_t)ms * 1000);
+        return;
+    }
+    Sleep(ms);
+}
 
-void delay(int ms) { Sleep(ms); }
+void delay(int ms) { delay((unsigned long)ms); }
 
 void delayMicroseconds(unsigned int us)
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->advanceMicros(us);
+        return;
+    }
+    if (virtualDelays)
+    {
+        advanceMicros(us);
+        return;
+    }
     std::this_thread::sleep_for(std::chrono::microseconds(us));
 }
 
@@ -63,6 +142,7 @@ void pinMode(int pin, int mode)
 
 void digitalWrite(int pin, int value)
 {
+    FlightRecorder::recordPin(pin, value);
 
     int color;
     switch (pin)
@@ -80,6 +160,10 @@ void digitalWrite(int pin, int value)
         color = 0;
         break;
     }
+    if (MockWorld *world = MockWorld::current())
+    {
+        printf("[%s] ", world->name());
+    }
     printf("\x1B[%dm%.3f - %d to \x1B[%dm%s\x1B[0m\n", color, millis() / 1000.0, pin, value == LOW ? 91 : 92, value == LOW ? "LOW" : "HIGH");
 }
 
@@ -94,6 +178,10 @@ static std::map<int, int> mockAnalogValues;
 
 int analogRead(int pin)
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        return world->analogRead(pin);
+    }
     // Check if there's a mocked value for this pin
     if (mockAnalogValues.find(pin) != mockAnalogValues.end()) {
         return mockAnalogValues[pin];
@@ -104,14 +192,68 @@ int analogRead(int pin)
 
 void setMockAnalogRead(int pin, int value)
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->setAnalogRead(pin, value);
+        return;
+    }
     mockAnalogValues[pin] = value;
 }
 
 void clearMockAnalogReads()
 {
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->clearAnalogReads();
+        return;
+    }
     mockAnalogValues.clear();
 }
 
+// splitmix64: small, fast and fully determined by the seed
+static uint64_t randomState = 0x853c49e6748fea9bULL;
+
+static uint64_t nextRandom()
+{
+    uint64_t *state = &randomState;
+    if (MockWorld *world = MockWorld::current())
+    {
+        state = &world->randomState;
+    }
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+long random(long howbig)
+{
+    if (howbig <= 0)
+    {
+        return 0;
+    }
+    return (long)(nextRandom() % (uint64_t)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+    {
+        return howsmall;
+    }
+    return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (MockWorld *world = MockWorld::current())
+    {
+        world->randomState = seed;
+        return;
+    }
+    randomState = seed;
+}
+
 Stream::~Stream()
 {
     disconnectSITL();
@@ -134,7 +276,8 @@ void Stream::clearBuffer()
 
 void Stream::pollSITLInput()
 {
-    if (!sitlSocket || !sitlSocket->isConnected()) {
+    bool sitlActive = sitlSocket && sitlSocket->isConnected();
+    if (!sitlActive && !rxChannel) {
         return;
     }
 
@@ -151,9 +294,11 @@ void Stream::pollSITLInput()
         return; // Buffer full
     }
 
-    // Read available data from SITL socket
+    // Read available data from SITL socket or in-memory link
     uint8_t tempBuffer[256];
-    int bytesRead = sitlSocket->read(tempBuffer, sizeof(tempBuffer) < roomAvailable ? sizeof(tempBuffer) : roomAvailable);
+    size_t maxRead = sizeof(tempBuffer) < (size_t)roomAvailable ? sizeof(tempBuffer) : (size_t)roomAvailable;
+    int bytesRead = sitlActive ? sitlSocket->read(tempBuffer, maxRead)
+                               : (int)rxChannel->read(tempBuffer, maxRead);
 
     if (bytesRead > 0) {
         // Append to input buffer
@@ -238,25 +383,57 @@ size_t Stream::readBytes(uint8_t *buffer, size_t length)
     return readBytes((char *)buffer, length);
 }
 
-size_t Stream::write(uint8_t b)
+void Stream::recordByte(uint8_t b)
 {
+    // Keep completed lines in the crash flight recorder
+    if (b == '\n') {
+        FlightRecorder::recordSerialLine(recorderLine, recorderLength);
+        recorderLength = 0;
+    } else if (b != '\r' && recorderLength < sizeof(recorderLine)) {
+        recorderLine[recorderLength++] = (char)b;
+    }
+
     // Write to fake buffer for debugging/logging
     if (cursor < sizeof(fakeBuffer) - 1) {
         fakeBuffer[cursor++] = b;
         fakeBuffer[cursor] = '\0';
     }
     // std::cout << b;
+}
 
+size_t Stream::write(uint8_t b)
+{
+    return Stream::write(&b, 1);
+}
 
-    // If SITL is connected, send to external simulator
+size_t Stream::write(const uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        recordByte(buf[i]);
+    }
+
+    // If SITL is connected, send to external simulator. Passing the whole
+    // buffer lets UDP send every line it completes in one batch.
     if (sitlSocket && sitlSocket->isConnected()) {
-        sitlSocket->write(&b, 1);
+        sitlSocket->write(buf, len);
+    }
+
+    // If linked to another mock world, stage for the peer port
+    if (txChannel) {
+        txChannel->write(buf, len);
     }
 
-    return 1;
+    return len;
+}
+
+void Stream::flush()
+{
+    if (sitlSocket && sitlSocket->isConnected()) {
+        sitlSocket->flush();
+    }
 }
 
-bool Stream::connectSITL(const char* host, int port)
+bool Stream::connectSITL(const char* host, int port, bool udp)
 {
     if (!sitlSocket) {
         sitlSocket = new SITLSocket();
@@ -266,7 +443,7 @@ bool Stream::connectSITL(const char* host, int port)
         sitlSocket->disconnect();
     }
 
-    return sitlSocket->connect(host, port);
+    return sitlSocket->connect(host, port, udp ? SITLSocket::UDP : SITLSocket::TCP);
 }
 
 void Stream::disconnectSITL()
@@ -283,8 +460,86 @@ bool Stream::isSITLConnected() const
     return sitlSocket && sitlSocket->isConnected();
 }
 
-HardwareSerial Serial;
-HardwareSerial Serial1;
-HardwareSerial Serial2;
-HardwareSerial Serial3;
+void Stream::attachChannels(SerialChannel* rx, SerialChannel* tx)
+{
+    rxChannel = rx;
+    txChannel = tx;
+}
+
+Stream* HardwareSerial::worldPort() const
+{
+    MockWorld *world = MockWorld::current();
+    return world ? &world->serial(portIndex) : nullptr;
+}
+
+bool HardwareSerial::available()
+{
+    if (Stream *s = worldPort()) return s->available();
+    return Stream::available();
+}
+
+int HardwareSerial::peek()
+{
+    if (Stream *s = worldPort()) return s->peek();
+    return Stream::peek();
+}
+
+int HardwareSerial::read()
+{
+    if (Stream *s = worldPort()) return s->read();
+    return Stream::read();
+}
+
+size_t HardwareSerial::write(uint8_t b)
+{
+    if (Stream *s = worldPort()) return s->write(b);
+    return Stream::write(b);
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len)
+{
+    if (Stream *s = worldPort()) return s->write(buf, len);
+    return Stream::write(buf, len);
+}
+
+void HardwareSerial::flush()
+{
+    if (Stream *s = worldPort()) return s->flush();
+    Stream::flush();
+}
+
+void HardwareSerial::clearBuffer()
+{
+    if (Stream *s = worldPort()) return s->clearBuffer();
+    Stream::clearBuffer();
+}
+
+void HardwareSerial::simulateInput(const char *data)
+{
+    if (Stream *s = worldPort()) return s->simulateInput(data);
+    Stream::simulateInput(data);
+}
+
+bool HardwareSerial::connectSITL(const char* host, int port, bool udp)
+{
+    if (Stream *s = worldPort()) return s->connectSITL(host, port, udp);
+    return Stream::connectSITL(host, port, udp);
+}
+
+void HardwareSerial::disconnectSITL()
+{
+    if (Stream *s = worldPort()) return s->disconnectSITL();
+    Stream::disconnectSITL();
+}
+
+bool HardwareSerial::isSITLConnected() const
+{
+    if (Stream *s = worldPort()) return s->isSITLConnected();
+    return Stream::isSITLConnected();
+}
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+HardwareSerial Serial3(3);
 CrashReportClass CrashReport;
\ No newline at end of file
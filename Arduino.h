@@ -108,6 +108,16 @@ uint64_t micros();
 
 void setMillis(uint64_t ms);
 
+// Microsecond-resolution fake clock (setMicros switches to the fake clock like setMillis)
+void setMicros(uint64_t us);
+void advanceMicros(uint64_t us);
+
+// Run on the fake clock and let delay()/delayMicroseconds() advance it instead of sleeping
+void setVirtualTime(bool enabled);
+
+// True when micros() reads the fake clock (setMillis/setMicros or a bound MockWorld)
+bool fakeClockActive();
+
 void resetMillis();
 
 void delay(unsigned long ms);
@@ -124,6 +134,13 @@ void pinMode(int pin, int mode);
 
 int analogRead(int pin);
 
+#ifdef __cplusplus
+// Arduino random numbers (seeded per run with --seed or randomSeed())
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+#endif
+
 // Mock helpers for testing
 void setMockAnalogRead(int pin, int value);
 void clearMockAnalogReads();
@@ -132,6 +149,8 @@ void clearMockAnalogReads();
 
 // Forward declaration for SITL support
 class SITLSocket;
+// Forward declaration for in-memory serial links between mock worlds
+class SerialChannel;
 
 // Arduino String class
 #include <string>
@@ -215,13 +234,7 @@ public:
     size_t readBytes(char *buf, size_t len);
     size_t readBytes(uint8_t *buf, size_t len);
     size_t write(uint8_t b) override;
-    size_t write(const uint8_t *buf, size_t len) {  // Add buffer write
-        size_t written = 0;
-        for (size_t i = 0; i < len; i++) {
-            written += write(buf[i]);
-        }
-        return written;
-    }
+    size_t write(const uint8_t *buf, size_t len) override;  // Whole buffer to the socket/channel at once
     
     String readString() {
         String ret = "";
@@ -241,8 +254,9 @@ public:
         while (millis() - startTime < timeout) {
             int c = read();
             if (c < 0) {
-                // No data available - yield and try again
-                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                // No data available - yield and try again (advances the
+                // virtual clock when running inside a MockWorld)
+                delayMicroseconds(100);
                 continue;
             }
             if (c == terminator) {
@@ -259,11 +273,18 @@ public:
     // For simulating incoming data in tests
     void simulateInput(const char *data);
 
+    // Sends any partially filled SITL datagram (UDP mode)
+    void flush() override;
+
     // SITL (Software-In-The-Loop) mode - connect to external simulator
-    bool connectSITL(const char* host, int port);
+    // over TCP, or over UDP datagrams when udp is true
+    bool connectSITL(const char* host, int port, bool udp = false);
     void disconnectSITL();
     bool isSITLConnected() const;
 
+    // In-memory link to another mock serial port (see MockWorld::linkSerial)
+    void attachChannels(SerialChannel* rx, SerialChannel* tx);
+
     char fakeBuffer[1000];
     int cursor = 0;
     // Input buffer for read operations
@@ -273,7 +294,12 @@ public:
 
 private:
     SITLSocket* sitlSocket = nullptr;  // TCP connection to external simulator
+    SerialChannel* rxChannel = nullptr;  // In-memory link (not owned)
+    SerialChannel* txChannel = nullptr;
+    char recorderLine[40];  // Current output line for the FlightRecorder
+    uint8_t recorderLength = 0;
     void pollSITLInput();  // Poll for incoming data from simulator
+    void recordByte(uint8_t b);  // Flight recorder line and debug buffer
 };
 
 
@@ -282,9 +308,30 @@ class SerialClass : public Stream
 {
 public:
 };
+
+// The global Serial objects forward to the port of the MockWorld bound to the
+// calling thread, if any, so each firmware instance sees its own serial state.
 class HardwareSerial : public SerialClass
 {
 public:
+    explicit HardwareSerial(int portIndex = 0) : portIndex(portIndex) {}
+
+    bool available() override;
+    int peek() override;
+    int read() override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buf, size_t len) override;
+    void flush() override;
+
+    void clearBuffer();
+    void simulateInput(const char *data);
+    bool connectSITL(const char* host, int port, bool udp = false);
+    void disconnectSITL();
+    bool isSITLConnected() const;
+
+private:
+    int portIndex;
+    Stream* worldPort() const;
 };
 
 extern HardwareSerial Serial;
@@ -5,6 +5,15 @@
  * and loop() repeatedly, mimicking Arduino behavior on native platforms.
  *
  * Only compiled when NOT running unit tests (when PIO_UNIT_TESTING is not defined)
+ *
+ * Build with NATIVE_MULTI_INSTANCE defined to run several firmware instances in
+ * one process instead: user code then provides configureFirmwareHost(), which
+ * registers each instance's entry points and serial links on a FirmwareHost.
+ *
+ * Run with --help for the command-line options: duration and iteration
+ * limits, seed, SITL endpoint and output directory. The loop stops when a
+ * limit is hit, on SIGINT/SIGTERM or when requestNativeShutdown() is called;
+ * registered logs are then flushed and a JSON run summary is written.
  */
 
 #if !defined(PIO_UNIT_TESTING) && !defined(UNITY_BEGIN)
@@ -13,57 +22,310 @@
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include "LoopProfiler.h"
+#include "LoopScheduler.h"
+#include "NativeRuntime.h"
+#include "MonteCarloRunner.h"
+#include "FlightRecorder.h"
 
+#ifdef NATIVE_MULTI_INSTANCE
+#include "FirmwareHost.h"
+
+// Provided by user code: add instances and links to the host
+extern void configureFirmwareHost(FirmwareHost& host);
+#else
 // Forward declarations for setup() and loop() from user code
 extern void setup();
 extern void loop();
+#endif
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define NATIVE_HAS_BACKTRACE 1
+#endif
+#ifndef _WIN32
+#include <unistd.h>
+#define NATIVE_HAS_SIGACTION 1
+#endif
+
+// Alternate stack so stack overflows can still be reported
+static char crashStack[64 * 1024];
 
 // Signal handler for crashes
+// Only async-signal-safe calls from here on: write(2) via FlightRecorder helpers,
+// backtrace_symbols_fd() and _exit().
 void crash_handler(int sig) {
+    const int fd = 2;
     const char* signal_name = "UNKNOWN";
     switch(sig) {
         case SIGSEGV: signal_name = "SIGSEGV (Segmentation Fault)"; break;
         case SIGABRT: signal_name = "SIGABRT (Abort)"; break;
         case SIGFPE: signal_name = "SIGFPE (Floating Point Exception)"; break;
         case SIGILL: signal_name = "SIGILL (Illegal Instruction)"; break;
+#ifdef SIGBUS
+        case SIGBUS: signal_name = "SIGBUS (Bus Error)"; break;
+#endif
     }
 
-    fprintf(stderr, "\n\n");
-    fprintf(stderr, "========================================\n");
-    fprintf(stderr, "CRASH DETECTED!\n");
-    fprintf(stderr, "Signal: %s (%d)\n", signal_name, sig);
-    fprintf(stderr, "========================================\n");
-    fprintf(stderr, "The program crashed. Possible causes:\n");
-    fprintf(stderr, "  - Null pointer dereference\n");
-    fprintf(stderr, "  - Buffer overflow\n");
-    fprintf(stderr, "  - Stack overflow\n");
-    fprintf(stderr, "  - Division by zero\n");
-    fprintf(stderr, "  - Invalid memory access\n");
-    fprintf(stderr, "========================================\n");
-    fflush(stderr);
+    FlightRecorder::writeText(fd, "\n\n");
+    FlightRecorder::writeText(fd, "========================================\n");
+    FlightRecorder::writeText(fd, "CRASH DETECTED!\n");
+    FlightRecorder::writeText(fd, "Signal: ");
+    FlightRecorder::writeText(fd, signal_name);
+    FlightRecorder::writeText(fd, " (");
+    FlightRecorder::writeDecimal(fd, (uint64_t)sig);
+    FlightRecorder::writeText(fd, ")\n");
+    FlightRecorder::writeText(fd, "========================================\n");
+
+#ifdef NATIVE_HAS_BACKTRACE
+    void* frames[64];
+    int depth = backtrace(frames, 64);
+    FlightRecorder::writeText(fd, "Backtrace (resolve with addr2line -f -C -e <binary> <addr>):\n");
+    backtrace_symbols_fd(frames, depth, fd);
+    FlightRecorder::writeText(fd, "========================================\n");
+#endif
+
+    FlightRecorder::dump(fd);
+    FlightRecorder::writeText(fd, "========================================\n");
 
     // Exit with error code
-    exit(sig);
+    _exit(sig);
+}
+
+static void installCrashHandlers()
+{
+    const int signals[] = {
+        SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+#ifdef SIGBUS
+        SIGBUS,
+#endif
+    };
+
+#ifdef NATIVE_HAS_BACKTRACE
+    // The first backtrace() call may load libgcc; do it now rather than mid-crash
+    void* warmup[1];
+    backtrace(warmup, 1);
+#endif
+
+#ifdef NATIVE_HAS_SIGACTION
+    stack_t altStack;
+    memset(&altStack, 0, sizeof(altStack));
+    altStack.ss_sp = crashStack;
+    altStack.ss_size = sizeof(crashStack);
+    sigaltstack(&altStack, nullptr);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = crash_handler;
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (int sig : signals) {
+        sigaction(sig, &action, nullptr);
+    }
+#else
+    (void)crashStack;
+    for (int sig : signals) {
+        signal(sig, crash_handler);
+    }
+#endif
+}
+
+// Fill the run summary from the loop instrumentation that was active
+static void fillRunSummary(NativeRunSummary& summary, uint64_t iterations, uint64_t startMicros,
+                           std::chrono::steady_clock::time_point wallStart,
+                           const LoopProfiler* profiler, const LoopScheduler* scheduler)
+{
+    memset(&summary, 0, sizeof(summary));
+    snprintf(summary.exitReason, sizeof(summary.exitReason), "%s", nativeShutdownReason());
+    summary.exitCode = nativeShutdownExitCode();
+    summary.seed = nativeRunOptions().seed;
+    summary.iterations = iterations;
+    summary.virtualSeconds = (micros() - startMicros) / 1e6;
+    summary.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    if (profiler) {
+        summary.loopP50Micros = profiler->histogram().percentile(0.50) / 1000.0;
+        summary.loopP99Micros = profiler->histogram().percentile(0.99) / 1000.0;
+        summary.loopMaxMicros = profiler->histogram().max() / 1000.0;
+        summary.loopOverruns = profiler->overruns();
+    }
+    if (scheduler) {
+        summary.missedDeadlines = scheduler->missedDeadlines();
+    }
+}
+
+#ifndef NATIVE_MULTI_INSTANCE
+struct RunContext {
+    const NativeRunOptions* options;
+    LoopProfiler* profiler;
+    LoopScheduler* scheduler;
+    std::chrono::steady_clock::time_point wallStart;
+};
+
+// Call loop() until a limit is hit or a shutdown is requested, then flush
+static void runLoop(NativeRunSummary& summary, void* context)
+{
+    RunContext& run = *static_cast<RunContext*>(context);
+    const NativeRunOptions& options = *run.options;
+    LoopProfiler* profiler = run.profiler;
+    LoopScheduler* scheduler = run.scheduler;
+
+    run.wallStart = std::chrono::steady_clock::now();
+    uint64_t startMicros = micros();
+    uint64_t durationMicros = (uint64_t)(options.durationSeconds * 1e6);
+    uint64_t iterations = 0;
+
+    while (!nativeShutdownRequested()) {
+        if (scheduler) scheduler->beginIteration();
+        FlightRecorder::recordLoop(iterations);
+        if (profiler) profiler->beginIteration();
+        loop();
+        if (profiler) {
+            profiler->endIteration();
+            profiler->pollReportRequest();
+        }
+        if (scheduler) scheduler->endIteration();
+
+        iterations++;
+        if (options.maxIterations && iterations >= options.maxIterations) {
+            requestNativeShutdown("iteration_limit");
+        }
+        if (durationMicros && micros() - startMicros >= durationMicros) {
+            requestNativeShutdown("duration_limit");
+        }
+    }
+
+    // Clean shutdown: flush logs and serial, then report
+    runNativeFlushHooks();
+    Serial.flush();
+    fflush(stdout);
+
+    fillRunSummary(summary, iterations, startMicros, run.wallStart, profiler, scheduler);
+    if (options.runIndex >= 0) {
+        writeNativeRunSummary(summary, "run_summary.json");
+    }
+}
+#endif
+
+// Apply command-line options that must take effect before setup()
+static bool applyRunOptions(const NativeRunOptions& options)
+{
+    if (!options.outputDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(options.outputDir, ec);
+        std::filesystem::current_path(options.outputDir, ec);
+        if (ec) {
+            fprintf(stderr, "Cannot use output directory %s: %s\n", options.outputDir.c_str(), ec.message().c_str());
+            return false;
+        }
+    }
+    if (options.seedSet) {
+        randomSeed((unsigned long)options.seed);
+        srand((unsigned)options.seed);
+    }
+    // Monte Carlo workers connect after fork() so each gets its own socket
+    if (!options.sitlHost.empty() && options.runs <= 0) {
+        if (!Serial.connectSITL(options.sitlHost.c_str(), options.sitlPort, options.sitlUdp)) {
+            fprintf(stderr, "Cannot connect to SITL simulator at %s:%d\n", options.sitlHost.c_str(), options.sitlPort);
+            return false;
+        }
+    }
+    return true;
 }
 
 int main(int argc, char** argv) {
     // Install crash handlers
-    signal(SIGSEGV, crash_handler);
-    signal(SIGABRT, crash_handler);
-    signal(SIGFPE, crash_handler);
-    signal(SIGILL, crash_handler);
+    installCrashHandlers();
+
+    // Ctrl-C and kill stop the loop cleanly so logs are flushed
+    signal(SIGINT, requestNativeShutdownFromSignal);
+    signal(SIGTERM, requestNativeShutdownFromSignal);
 
     printf("Signal handlers installed\n");
     fflush(stdout);
 
+    NativeRunOptions& options = nativeRunOptions();
+    int parsed = parseNativeRunOptions(argc, argv, options);
+    if (parsed != 0) {
+        return parsed == 1 ? 0 : parsed;
+    }
+    if (!applyRunOptions(options)) {
+        return 2;
+    }
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    std::string summaryPath = options.summaryPath.empty() ? "run_summary.json" : options.summaryPath;
+    NativeRunSummary summary;
+
+#ifdef NATIVE_MULTI_INSTANCE
+    FirmwareHost host;
+    configureFirmwareHost(host);
+    printf("Running %zu firmware instances\n", host.instanceCount());
+    fflush(stdout);
+
+    // Limits are counted in lockstep ticks of the host's virtual clock
+    uint64_t ticks = options.maxIterations;
+    if (options.durationSeconds > 0) {
+        uint64_t durationTicks = (uint64_t)(options.durationSeconds * 1e6) / host.tickPeriodMicros();
+        if (ticks == 0 || durationTicks < ticks) {
+            ticks = durationTicks ? durationTicks : 1;
+        }
+    }
+
+    host.setup();
+    host.run(ticks);
+    if (!nativeShutdownRequested()) {
+        requestNativeShutdown(ticks == options.maxIterations ? "iteration_limit" : "duration_limit");
+    }
+
+    runNativeFlushHooks();
+    fflush(stdout);
+
+    fillRunSummary(summary, host.ticks(), 0, wallStart, nullptr, nullptr);
+    summary.virtualSeconds = host.ticks() * host.tickPeriodMicros() / 1e6;
+    writeNativeRunSummary(summary, summaryPath.c_str());
+    return summary.exitCode;
+#else
+    // Optional per-iteration profiling (see LoopProfiler.h)
+    LoopProfiler* profiler = options.profile ? new LoopProfiler(options.budgetMicros)
+                                             : LoopProfiler::fromEnvironment();
+    if (profiler) {
+        // Monte Carlo runs report through their summaries instead
+        if (options.runs <= 0) LoopProfiler::installReportHandlers(profiler);
+        printf("Loop profiler enabled (budget %lluus)\n", (unsigned long long)profiler->budgetMicros());
+        fflush(stdout);
+    }
+
+    // Optional fixed-rate virtual-time scheduling (see LoopScheduler.h)
+    LoopScheduler* scheduler = (options.rateHz > 0 || options.slowdown > 0)
+                                   ? new LoopScheduler(options.rateHz, options.slowdown, options.realtime)
+                                   : LoopScheduler::fromEnvironment();
+    if (scheduler) {
+        if (options.runs <= 0) LoopScheduler::installReportHandler(scheduler);
+        printf("Loop scheduler enabled (rate %.1fHz, slowdown %.2fx)\n", scheduler->rateHz(), scheduler->slowdown());
+        fflush(stdout);
+    }
+
     // Call setup once
     setup();
 
-    // Call loop repeatedly
-    while (true) {
-        loop();
+    RunContext run = {&options, profiler, scheduler, wallStart};
+    if (options.runs > 0) {
+        // Every forked run continues from the state setup() left behind
+        return runMonteCarlo(options, runLoop, &run);
     }
 
+    runLoop(summary, &run);
+    writeNativeRunSummary(summary, summaryPath.c_str());
+
+    printf("Run finished: %s after %llu iterations\n", summary.exitReason, (unsigned long long)summary.iterations);
+    fflush(stdout);
+    return summary.exitCode;
+#endif
+
     return 0;
 }
 
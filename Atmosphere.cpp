@@ -0,0 +1,177 @@
+#include "Atmosphere.h"
+#include <cmath>
+
+namespace {
+
+const double KELVIN = 273.15;
+const double G0_M_OVER_R = 9.80665 * 0.0289644 / 8.31432;  // K/m, US 1976 constants
+
+// Geopotential base altitude and lapse rate of each ISA layer
+const struct { double base; double lapse; } LAYER_DEFS[] = {
+    {0.0, -0.0065},     // Troposphere
+    {11000.0, 0.0},     // Tropopause
+    {20000.0, 0.001},   // Stratosphere
+    {32000.0, 0.0028},
+    {47000.0, 0.0},     // Stratopause
+    {51000.0, -0.0028}, // Mesosphere
+    {71000.0, -0.002},
+    {84852.0, 0.0},     // Mesopause, extended upwards
+};
+const int LAYER_COUNT = sizeof(LAYER_DEFS) / sizeof(LAYER_DEFS[0]);
+
+struct Layer
+{
+    double base;
+    double lapse;
+    double temperature;  // K at base
+    double pressure;     // Pa at base
+};
+
+const Layer* layers() {
+    static Layer table[LAYER_COUNT];
+    static bool ready = [] {
+        double t = Atmosphere::SEA_LEVEL_TEMPERATURE;
+        double p = Atmosphere::SEA_LEVEL_PRESSURE;
+        for (int i = 0; i < LAYER_COUNT; i++) {
+            if (i > 0) {
+                const Layer& below = table[i - 1];
+                double dh = LAYER_DEFS[i].base - below.base;
+                t = below.temperature + below.lapse * dh;
+                p = below.lapse == 0.0 ? below.pressure * exp(-G0_M_OVER_R * dh / below.temperature)
+                                       : below.pressure * pow(below.temperature / t, G0_M_OVER_R / below.lapse);
+            }
+            table[i] = { LAYER_DEFS[i].base, LAYER_DEFS[i].lapse, t, p };
+        }
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+// Layer containing a geopotential altitude; below sea level the troposphere continues
+const Layer& layerFor(double h) {
+    const Layer* table = layers();
+    int i = LAYER_COUNT - 1;
+    while (i > 0 && h < table[i].base) i--;
+    return table[i];
+}
+
+// Interpolation table on geopotential altitude; all layer bases up to 71 km are nodes
+const double TABLE_MIN = -5000.0;
+const double TABLE_MAX = 84800.0;
+const double TABLE_STEP = 100.0;
+const int NODE_COUNT = (int)((TABLE_MAX - TABLE_MIN) / TABLE_STEP) + 1;
+// The same range as geometric altitudes
+const double ALT_MIN = Atmosphere::EARTH_RADIUS * TABLE_MIN / (Atmosphere::EARTH_RADIUS - TABLE_MIN);
+const double ALT_MAX = Atmosphere::EARTH_RADIUS * TABLE_MAX / (Atmosphere::EARTH_RADIUS - TABLE_MAX);
+
+// Columns rather than structs, so a vectorised lookup gathers from each
+struct Table
+{
+    double pressure[NODE_COUNT];
+    double slope[NODE_COUNT];        // dP/dh * TABLE_STEP
+    double temperature[NODE_COUNT];  // K
+};
+
+const Table& nodes() {
+    static Table table;
+    static bool ready = [] {
+        for (int i = 0; i < NODE_COUNT; i++) {
+            double h = TABLE_MIN + i * TABLE_STEP;
+            const Layer& layer = layerFor(h);
+            double t = layer.temperature + layer.lapse * (h - layer.base);
+            double p = layer.lapse == 0.0 ? layer.pressure * exp(-G0_M_OVER_R * (h - layer.base) / layer.temperature)
+                                          : layer.pressure * pow(layer.temperature / t, G0_M_OVER_R / layer.lapse);
+            table.pressure[i] = p;
+            // Hydrostatic equation: dP/dh = -P g0 M / (R T)
+            table.slope[i] = -p * G0_M_OVER_R / t * TABLE_STEP;
+            table.temperature[i] = t;
+        }
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+// Node index and fraction for a geopotential altitude. The index is clamped
+// as an int (a clamp on the double defeats the vectoriser), so out-of-table
+// altitudes give a finite but meaningless result for the caller to replace.
+inline int cell(double h, double& f) {
+    double u = (h - TABLE_MIN) * (1.0 / TABLE_STEP);
+    int i = (int)u;
+    i = i < 0 ? 0 : i;
+    i = i > NODE_COUNT - 2 ? NODE_COUNT - 2 : i;
+    f = u - i;
+    return i;
+}
+
+// The table loops, which the scalar calls share with n = 1. The arithmetic
+// is written out and the tables are __restrict: without both, GCC cannot
+// separate the table gathers from the stores and will not vectorise.
+void pressures(const double* altM, double* out, size_t n,
+               const double* __restrict pressure, const double* __restrict slope) {
+    for (size_t k = 0; k < n; k++) {
+        double f;
+        int i = cell(Atmosphere::geopotential(altM[k]), f);
+        // Cubic Hermite between two nodes, using the exact slopes
+        double f2 = f * f;
+        double f3 = f2 * f;
+        out[k] = (2 * f3 - 3 * f2 + 1) * pressure[i] + (f3 - 2 * f2 + f) * slope[i] +
+                 (3 * f2 - 2 * f3) * pressure[i + 1] + (f3 - f2) * slope[i + 1];
+    }
+}
+
+void temperatures(const double* altM, double* out, size_t n, const double* __restrict temperature) {
+    for (size_t k = 0; k < n; k++) {
+        double f;
+        int i = cell(Atmosphere::geopotential(altM[k]), f);
+        out[k] = temperature[i] + (temperature[i + 1] - temperature[i]) * f - KELVIN;
+    }
+}
+
+bool inTable(double altM) {
+    return altM >= ALT_MIN && altM <= ALT_MAX;
+}
+
+} // namespace
+
+double Atmosphere::exactPressure(double altM) {
+    double h = geopotential(altM);
+    const Layer& layer = layerFor(h);
+    double dh = h - layer.base;
+    if (layer.lapse == 0.0) return layer.pressure * exp(-G0_M_OVER_R * dh / layer.temperature);
+    return layer.pressure * pow(layer.temperature / (layer.temperature + layer.lapse * dh), G0_M_OVER_R / layer.lapse);
+}
+
+double Atmosphere::exactTemperatureC(double altM) {
+    double h = geopotential(altM);
+    const Layer& layer = layerFor(h);
+    return layer.temperature + layer.lapse * (h - layer.base) - KELVIN;
+}
+
+double Atmosphere::pressure(double altM) {
+    if (!inTable(altM)) return exactPressure(altM);
+    const Table& table = nodes();
+    double p;
+    pressures(&altM, &p, 1, table.pressure, table.slope);
+    return p;
+}
+
+double Atmosphere::temperatureC(double altM) {
+    if (!inTable(altM)) return exactTemperatureC(altM);
+    double t;
+    temperatures(&altM, &t, 1, nodes().temperature);
+    return t;
+}
+
+void Atmosphere::evaluate(const double* altM, double* pressurePa, double* temperatureC, size_t n) {
+    const Table& table = nodes();
+    if (pressurePa) pressures(altM, pressurePa, n, table.pressure, table.slope);
+    if (temperatureC) temperatures(altM, temperatureC, n, table.temperature);
+    // Rare: altitudes beyond the table
+    for (size_t k = 0; k < n; k++) {
+        if (inTable(altM[k])) continue;
+        if (pressurePa) pressurePa[k] = exactPressure(altM[k]);
+        if (temperatureC) temperatureC[k] = exactTemperatureC(altM[k]);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+#include <cstddef>
+
+/**
+ * Atmosphere: International Standard Atmosphere (ISO 2533 / US 1976)
+ *
+ * Pressure and temperature for a geometric altitude above mean sea level,
+ * covering every ISA layer from the troposphere to the mesopause (86 km).
+ * The layers are defined on geopotential altitude; the conversion is done
+ * here, so callers pass plain metres above sea level.
+ *
+ * pressure() and temperatureC() read a table built on first use: one node
+ * every 100 m of geopotential altitude from -5 km to 84.8 km, with pressure
+ * interpolated by cubic Hermite using its exact slope (relative error below
+ * 1e-9) and temperature linearly, which is exact because every layer
+ * boundary is a node. Outside the table they fall back to the closed-form
+ * exactPressure() / exactTemperatureC().
+ *
+ * evaluate() converts whole arrays. Its main loop is branch-free and free of
+ * library calls so the compiler can vectorise it; out-of-table altitudes
+ * are patched up afterwards.
+ */
+class Atmosphere
+{
+public:
+    static constexpr double SEA_LEVEL_PRESSURE = 101325.0;    // Pa
+    static constexpr double SEA_LEVEL_TEMPERATURE = 288.15;   // K
+    static constexpr double EARTH_RADIUS = 6356766.0;         // m, for geopotential altitude
+
+    /**
+     * Static pressure in Pa at an altitude in metres above sea level
+     */
+    static double pressure(double altM);
+
+    /**
+     * Static temperature in degrees C at an altitude in metres above sea level
+     */
+    static double temperatureC(double altM);
+
+    /**
+     * pressure() and temperatureC() for n altitudes; either output may be
+     * nullptr
+     */
+    static void evaluate(const double* altM, double* pressurePa, double* temperatureC, size_t n);
+
+    /**
+     * Closed-form ISA, evaluated layer by layer (uses pow/exp)
+     */
+    static double exactPressure(double altM);
+    static double exactTemperatureC(double altM);
+
+    /**
+     * Geopotential altitude for a geometric one, both in metres
+     */
+    static double geopotential(double altM) { return EARTH_RADIUS * altM / (EARTH_RADIUS + altM); }
+};
+
+#endif // ATMOSPHERE_H
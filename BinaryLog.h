@@ -0,0 +1,547 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Print.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Binary telemetry logs: a self-describing schema header followed by
+ * fixed-layout records, written through any Print (usually a NativeFileLog)
+ * and read back with BinaryLogReader without text parsing.
+ *
+ * File layout (host byte order, i.e. little-endian on every supported host):
+ *   "NBLOG1\r\n"                      8-byte magic
+ *   u32 headerSize                    bytes from the start of the file to the data
+ *   u16 version, u16 fieldCount
+ *   u32 rowSize                       sum of the field sizes, no padding
+ *   u32 blockRows                     0 for row layout, else rows per column block
+ *   fieldCount x { u8 type, u8 nameLength, name }
+ *
+ * Row layout: rows of rowSize bytes back to back, fields in schema order.
+ * Column layout: blocks of { u32 rows, then each field's values for those
+ * rows contiguously }. Blocks hold blockRows rows except where the writer was
+ * flushed early. A torn final row or block is ignored by the reader.
+ */
+
+enum class BinaryType : uint8_t
+{
+    U8 = 1, I8, U16, I16, U32, I32, U64, I64, F32, F64
+};
+
+inline uint32_t binaryTypeSize(BinaryType type)
+{
+    switch (type) {
+        case BinaryType::U8:
+        case BinaryType::I8: return 1;
+        case BinaryType::U16:
+        case BinaryType::I16: return 2;
+        case BinaryType::U32:
+        case BinaryType::I32:
+        case BinaryType::F32: return 4;
+        case BinaryType::U64:
+        case BinaryType::I64:
+        case BinaryType::F64: return 8;
+    }
+    return 0;
+}
+
+template <typename T> struct BinaryTypeOf;
+template <> struct BinaryTypeOf<uint8_t> { static const BinaryType value = BinaryType::U8; };
+template <> struct BinaryTypeOf<int8_t> { static const BinaryType value = BinaryType::I8; };
+template <> struct BinaryTypeOf<uint16_t> { static const BinaryType value = BinaryType::U16; };
+template <> struct BinaryTypeOf<int16_t> { static const BinaryType value = BinaryType::I16; };
+template <> struct BinaryTypeOf<uint32_t> { static const BinaryType value = BinaryType::U32; };
+template <> struct BinaryTypeOf<int32_t> { static const BinaryType value = BinaryType::I32; };
+template <> struct BinaryTypeOf<uint64_t> { static const BinaryType value = BinaryType::U64; };
+template <> struct BinaryTypeOf<int64_t> { static const BinaryType value = BinaryType::I64; };
+template <> struct BinaryTypeOf<float> { static const BinaryType value = BinaryType::F32; };
+template <> struct BinaryTypeOf<double> { static const BinaryType value = BinaryType::F64; };
+
+/**
+ * Store value at p as the given field type
+ */
+template <typename T>
+inline void binaryStore(uint8_t* p, BinaryType type, T value)
+{
+    switch (type) {
+        case BinaryType::U8: { uint8_t v = (uint8_t)value; memcpy(p, &v, 1); break; }
+        case BinaryType::I8: { int8_t v = (int8_t)value; memcpy(p, &v, 1); break; }
+        case BinaryType::U16: { uint16_t v = (uint16_t)value; memcpy(p, &v, 2); break; }
+        case BinaryType::I16: { int16_t v = (int16_t)value; memcpy(p, &v, 2); break; }
+        case BinaryType::U32: { uint32_t v = (uint32_t)value; memcpy(p, &v, 4); break; }
+        case BinaryType::I32: { int32_t v = (int32_t)value; memcpy(p, &v, 4); break; }
+        case BinaryType::U64: { uint64_t v = (uint64_t)value; memcpy(p, &v, 8); break; }
+        case BinaryType::I64: { int64_t v = (int64_t)value; memcpy(p, &v, 8); break; }
+        case BinaryType::F32: { float v = (float)value; memcpy(p, &v, 4); break; }
+        case BinaryType::F64: { double v = (double)value; memcpy(p, &v, 8); break; }
+    }
+}
+
+/**
+ * Load the field value at p, converted to T
+ */
+template <typename T>
+inline T binaryLoad(const uint8_t* p, BinaryType type)
+{
+    switch (type) {
+        case BinaryType::U8: { uint8_t v; memcpy(&v, p, 1); return (T)v; }
+        case BinaryType::I8: { int8_t v; memcpy(&v, p, 1); return (T)v; }
+        case BinaryType::U16: { uint16_t v; memcpy(&v, p, 2); return (T)v; }
+        case BinaryType::I16: { int16_t v; memcpy(&v, p, 2); return (T)v; }
+        case BinaryType::U32: { uint32_t v; memcpy(&v, p, 4); return (T)v; }
+        case BinaryType::I32: { int32_t v; memcpy(&v, p, 4); return (T)v; }
+        case BinaryType::U64: { uint64_t v; memcpy(&v, p, 8); return (T)v; }
+        case BinaryType::I64: { int64_t v; memcpy(&v, p, 8); return (T)v; }
+        case BinaryType::F32: { float v; memcpy(&v, p, 4); return (T)v; }
+        case BinaryType::F64: { double v; memcpy(&v, p, 8); return (T)v; }
+    }
+    return T();
+}
+
+struct BinaryField
+{
+    std::string name;
+    BinaryType type;
+    uint32_t offset;  // Within a row
+    uint32_t size;
+};
+
+/**
+ * BinarySchema: Ordered list of named, typed fields making up one record
+ */
+class BinarySchema
+{
+public:
+    static constexpr uint8_t MAGIC[8] = {'N', 'B', 'L', 'O', 'G', '1', '\r', '\n'};
+    static const uint16_t VERSION = 1;
+
+    /**
+     * @return Index of the new field, used with BinaryLogWriter::set() and the reader
+     */
+    int add(const std::string& name, BinaryType type) {
+        BinaryField field;
+        field.name = name.size() > 255 ? name.substr(0, 255) : name;
+        field.type = type;
+        field.offset = _rowSize;
+        field.size = binaryTypeSize(type);
+        _rowSize += field.size;
+        _fields.push_back(field);
+        return (int)_fields.size() - 1;
+    }
+
+    template <typename T>
+    int add(const std::string& name) { return add(name, BinaryTypeOf<T>::value); }
+
+    size_t fieldCount() const { return _fields.size(); }
+    const BinaryField& field(int index) const { return _fields[(size_t)index]; }
+    const std::vector<BinaryField>& fields() const { return _fields; }
+    uint32_t rowSize() const { return _rowSize; }
+
+    /**
+     * @return Field index, or -1 if there is no field with that name
+     */
+    int indexOf(const std::string& name) const {
+        for (size_t i = 0; i < _fields.size(); i++) {
+            if (_fields[i].name == name) return (int)i;
+        }
+        return -1;
+    }
+
+    /**
+     * Serialize the file header
+     */
+    std::vector<uint8_t> encodeHeader(uint32_t blockRows) const {
+        std::vector<uint8_t> out(MAGIC, MAGIC + sizeof(MAGIC));
+        size_t sizeAt = out.size();
+        put32(out, 0);  // headerSize, patched below
+        put16(out, VERSION);
+        put16(out, (uint16_t)_fields.size());
+        put32(out, _rowSize);
+        put32(out, blockRows);
+        for (const BinaryField& field : _fields) {
+            out.push_back((uint8_t)field.type);
+            out.push_back((uint8_t)field.name.size());
+            out.insert(out.end(), field.name.begin(), field.name.end());
+        }
+        uint32_t headerSize = (uint32_t)out.size();
+        memcpy(&out[sizeAt], &headerSize, 4);
+        return out;
+    }
+
+    /**
+     * Parse a file header
+     * @param headerSize Set to the offset of the first row or block
+     * @return false if the data does not start with a valid header
+     */
+    static bool decodeHeader(const uint8_t* data, size_t length, BinarySchema& schema,
+                             uint32_t& blockRows, size_t& headerSize) {
+        const size_t fixed = sizeof(MAGIC) + 16;
+        if (length < fixed || memcmp(data, MAGIC, sizeof(MAGIC)) != 0) return false;
+        uint32_t size, rowSize;
+        uint16_t version, count;
+        const uint8_t* p = data + sizeof(MAGIC);
+        memcpy(&size, p, 4);
+        memcpy(&version, p + 4, 2);
+        memcpy(&count, p + 6, 2);
+        memcpy(&rowSize, p + 8, 4);
+        memcpy(&blockRows, p + 12, 4);
+        if (version != VERSION || size > length || size < fixed) return false;
+        schema = BinarySchema();
+        size_t at = fixed;
+        for (uint16_t i = 0; i < count; i++) {
+            if (at + 2 > size) return false;
+            BinaryType type = (BinaryType)data[at];
+            size_t nameLength = data[at + 1];
+            if (binaryTypeSize(type) == 0 || at + 2 + nameLength > size) return false;
+            schema.add(std::string((const char*)data + at + 2, nameLength), type);
+            at += 2 + nameLength;
+        }
+        if (schema.rowSize() != rowSize || rowSize == 0) return false;
+        headerSize = size;
+        return true;
+    }
+
+private:
+    static void put16(std::vector<uint8_t>& out, uint16_t v) {
+        out.insert(out.end(), (const uint8_t*)&v, (const uint8_t*)&v + 2);
+    }
+    static void put32(std::vector<uint8_t>& out, uint32_t v) {
+        out.insert(out.end(), (const uint8_t*)&v, (const uint8_t*)&v + 4);
+    }
+
+    std::vector<BinaryField> _fields;
+    uint32_t _rowSize = 0;
+};
+
+struct BinaryLogOptions
+{
+    // 0 writes row layout; otherwise rows are buffered and written as column
+    // blocks of this many rows (one Print::write() per block)
+    uint32_t blockRows = 0;
+};
+
+/**
+ * BinaryLogWriter: Writes schema-described records to a Print
+ *
+ * Fill the pending row with set() and append it with commit(), or append a
+ * packed row with writeRow(). Each row (or column block) reaches the output
+ * in a single write() call, so an async NativeFileLog keeps them intact when
+ * several writers share it. The writer itself is not thread-safe.
+ *
+ * Example:
+ *   BinarySchema schema;
+ *   int t = schema.add<uint64_t>("micros");
+ *   int alt = schema.add<float>("altitude");
+ *   NativeFileLog file("flight.bin");
+ *   file.begin();
+ *   BinaryLogWriter log(file, schema);
+ *   log.begin();
+ *   log.set(t, micros());
+ *   log.set(alt, baro.getAltitude());
+ *   log.commit();
+ */
+class BinaryLogWriter
+{
+public:
+    BinaryLogWriter(Print& out, const BinarySchema& schema, const BinaryLogOptions& options = BinaryLogOptions())
+        : _out(out), _schema(schema), _options(options), _row(schema.rowSize(), 0) {
+        if (_options.blockRows) {
+            _block.resize(4 + (size_t)_options.blockRows * _schema.rowSize());
+        }
+    }
+
+    ~BinaryLogWriter() { end(); }
+
+    BinaryLogWriter(const BinaryLogWriter&) = delete;
+    BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+
+    /**
+     * Write the schema header
+     */
+    bool begin() {
+        std::vector<uint8_t> header = _schema.encodeHeader(_options.blockRows);
+        _started = _out.write(header.data(), header.size()) == header.size();
+        return _started;
+    }
+
+    /**
+     * Set a field of the pending row (converted to the field's type)
+     */
+    template <typename T>
+    void set(int field, T value) {
+        const BinaryField& f = _schema.field(field);
+        binaryStore(&_row[f.offset], f.type, value);
+    }
+
+    /**
+     * Append the pending row; its values are kept for the next one
+     */
+    bool commit() { return writeRow(_row.data()); }
+
+    /**
+     * Append one row given as rowSize() packed bytes in schema order
+     */
+    bool writeRow(const void* row) {
+        if (!_started) return false;
+        _rows++;
+        if (!_options.blockRows) {
+            size_t n = _schema.rowSize();
+            return _out.write((const uint8_t*)row, n) == n;
+        }
+        // Scatter the row into the column regions of the block
+        const uint8_t* src = (const uint8_t*)row;
+        uint8_t* columns = &_block[4];
+        for (const BinaryField& f : _schema.fields()) {
+            memcpy(columns + (size_t)f.offset * _options.blockRows + (size_t)_blockFill * f.size,
+                   src + f.offset, f.size);
+        }
+        if (++_blockFill == _options.blockRows) return writeBlock();
+        return true;
+    }
+
+    /**
+     * Write a partly filled column block (row layout has nothing buffered)
+     */
+    bool flush() {
+        if (!_started || _blockFill == 0) return true;
+        return writeBlock();
+    }
+
+    bool end() {
+        bool ok = flush();
+        _started = false;
+        return ok;
+    }
+
+    const BinarySchema& schema() const { return _schema; }
+    uint64_t rows() const { return _rows; }
+
+private:
+    bool writeBlock() {
+        uint32_t rows = _blockFill;
+        memcpy(&_block[0], &rows, 4);
+        uint8_t* columns = &_block[4];
+        if (rows < _options.blockRows) {
+            // Short block: close the gaps between the column regions
+            for (const BinaryField& f : _schema.fields()) {
+                memmove(columns + (size_t)f.offset * rows,
+                        columns + (size_t)f.offset * _options.blockRows, (size_t)f.size * rows);
+            }
+        }
+        size_t n = 4 + (size_t)rows * _schema.rowSize();
+        _blockFill = 0;
+        return _out.write(_block.data(), n) == n;
+    }
+
+    Print& _out;
+    BinarySchema _schema;
+    BinaryLogOptions _options;
+    std::vector<uint8_t> _row;
+    std::vector<uint8_t> _block;  // u32 row count, then one region of blockRows values per field
+    uint32_t _blockFill = 0;
+    uint64_t _rows = 0;
+    bool _started = false;
+};
+
+/**
+ * BinaryLogReader: Memory-mapped reader for BinaryLogWriter files
+ *
+ * Opening maps the file and indexes the column blocks; values are then read
+ * straight from the mapping. scan() and column() decode one field for every
+ * row with the type switch hoisted out of the loop, which in column layout
+ * is a sequential pass over contiguous values.
+ */
+class BinaryLogReader
+{
+public:
+    explicit BinaryLogReader(const std::string& path) {
+        if (!map(path)) return;
+        size_t headerSize = 0;
+        if (!BinarySchema::decodeHeader(_data, _size, _schema, _blockRows, headerSize)) {
+            fprintf(stderr, "BinaryLogReader: %s is not a binary log\n", path.c_str());
+            return;
+        }
+        indexBlocks(headerSize);
+        _ok = true;
+    }
+
+    ~BinaryLogReader() { unmap(); }
+
+    BinaryLogReader(const BinaryLogReader&) = delete;
+    BinaryLogReader& operator=(const BinaryLogReader&) = delete;
+
+    bool ok() const { return _ok; }
+    const BinarySchema& schema() const { return _schema; }
+    bool columnar() const { return _blockRows != 0; }
+    uint64_t rows() const { return _rows; }
+    size_t blockCount() const { return _blocks.size(); }
+
+    /**
+     * One field of one row, converted to T
+     */
+    template <typename T>
+    T get(uint64_t row, int field) const {
+        const BinaryField& f = _schema.field(field);
+        const Block& b = blockOf(row);
+        return binaryLoad<T>(fieldBase(b, f) + (row - b.firstRow) * stride(f), f.type);
+    }
+
+    /**
+     * Call fn(T value) for one field of every row, in order
+     */
+    template <typename T, typename F>
+    void scan(int field, F&& fn) const {
+        const BinaryField& f = _schema.field(field);
+        for (const Block& b : _blocks) {
+            const uint8_t* p = fieldBase(b, f);
+            size_t step = stride(f);
+            switch (f.type) {
+                case BinaryType::U8: scanSpan<uint8_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::I8: scanSpan<int8_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::U16: scanSpan<uint16_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::I16: scanSpan<int16_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::U32: scanSpan<uint32_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::I32: scanSpan<int32_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::U64: scanSpan<uint64_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::I64: scanSpan<int64_t, T>(p, step, b.rows, fn); break;
+                case BinaryType::F32: scanSpan<float, T>(p, step, b.rows, fn); break;
+                case BinaryType::F64: scanSpan<double, T>(p, step, b.rows, fn); break;
+            }
+        }
+    }
+
+    /**
+     * Every value of one field, converted to T
+     */
+    template <typename T>
+    std::vector<T> column(int field) const {
+        std::vector<T> values;
+        values.reserve((size_t)_rows);
+        scan<T>(field, [&values](T v) { values.push_back(v); });
+        return values;
+    }
+
+private:
+    struct Block {
+        uint64_t firstRow;
+        uint32_t rows;
+        const uint8_t* data;  // First row (row layout) or first column region
+    };
+
+    template <typename S, typename T, typename F>
+    static void scanSpan(const uint8_t* p, size_t step, uint32_t rows, F& fn) {
+        for (uint32_t i = 0; i < rows; i++) {
+            S v;
+            memcpy(&v, p + (size_t)i * step, sizeof(S));
+            fn((T)v);
+        }
+    }
+
+    size_t stride(const BinaryField& f) const { return _blockRows ? f.size : _schema.rowSize(); }
+
+    const uint8_t* fieldBase(const Block& b, const BinaryField& f) const {
+        return _blockRows ? b.data + (size_t)f.offset * b.rows : b.data + f.offset;
+    }
+
+    const Block& blockOf(uint64_t row) const {
+        auto it = std::upper_bound(_blocks.begin(), _blocks.end(), row,
+                                   [](uint64_t r, const Block& b) { return r < b.firstRow; });
+        return *(it - 1);
+    }
+
+    void indexBlocks(size_t at) {
+        uint32_t rowSize = _schema.rowSize();
+        if (!_blockRows) {
+            // Row layout is one block; a torn last row is dropped
+            Block b = { 0, (uint32_t)((_size - at) / rowSize), _data + at };
+            _rows = b.rows;
+            if (b.rows) _blocks.push_back(b);
+            return;
+        }
+        while (at + 4 <= _size) {
+            uint32_t rows;
+            memcpy(&rows, _data + at, 4);
+            size_t bytes = (size_t)rows * rowSize;
+            if (rows == 0 || rows > _blockRows || at + 4 + bytes > _size) break;  // Torn block
+            Block b = { _rows, rows, _data + at + 4 };
+            _blocks.push_back(b);
+            _rows += rows;
+            at += 4 + bytes;
+        }
+    }
+
+    bool map(const std::string& path) {
+#ifdef _WIN32
+        // No mmap here: load the file once
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long end = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (end > 0) {
+            uint8_t* buffer = (uint8_t*)malloc((size_t)end);
+            if (!buffer || fread(buffer, 1, (size_t)end, f) != (size_t)end) {
+                free(buffer);
+                fclose(f);
+                return false;
+            }
+            _data = buffer;
+            _size = (size_t)end;
+        }
+        fclose(f);
+        return true;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        if (st.st_size > 0) {
+            void* addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+            _data = (const uint8_t*)addr;
+            _size = (size_t)st.st_size;
+        }
+        ::close(fd);
+        return true;
+#endif
+    }
+
+    void unmap() {
+#ifdef _WIN32
+        free((void*)_data);
+#else
+        if (_data) munmap((void*)_data, _size);
+#endif
+        _data = nullptr;
+    }
+
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    bool _ok = false;
+    BinarySchema _schema;
+    uint32_t _blockRows = 0;
+    uint64_t _rows = 0;
+    std::vector<Block> _blocks;
+};
+
+#endif // BINARY_LOG_H
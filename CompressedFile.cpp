@@ -0,0 +1,441 @@
+#include "CompressedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+const uint8_t CompressedFile::MAGIC[8] = {0x89, 'N', 'L', 'Z', '1', '\r', '\n', 0x1a};
+
+static const size_t FILE_HEADER_SIZE = 12;   // MAGIC + u32 block size
+static const size_t BLOCK_HEADER_SIZE = 8;   // u32 raw length + u32 stored length
+static const uint32_t MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// Codec parameters (LZ4 block format conventions)
+static const int HASH_BITS = 14;
+static const size_t MIN_MATCH = 4;
+static const size_t LAST_LITERALS = 5;   // The block always ends with literals
+static const size_t MATCH_LIMIT = 12;    // No match starts this close to the end
+static const size_t MAX_OFFSET = 65535;
+
+static inline uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static inline uint8_t* writeLength(uint8_t* op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static inline void putLE32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t getLE32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Length of the common prefix of a and b, stopping at limit
+static inline const uint8_t* extendMatch(const uint8_t* a, const uint8_t* b, const uint8_t* limit)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (a + 8 <= limit) {
+        uint64_t x, y;
+        memcpy(&x, a, 8);
+        memcpy(&y, b, 8);
+        if (x != y) {
+            return a + (__builtin_ctzll(x ^ y) >> 3);
+        }
+        a += 8;
+        b += 8;
+    }
+#endif
+    while (a < limit && *a == *b) {
+        a++;
+        b++;
+    }
+    return a;
+}
+
+size_t CompressedFile::compressBlock(const uint8_t* src, size_t length, uint8_t* dst)
+{
+    uint8_t* op = dst;
+    const uint8_t* anchor = src;
+    const uint8_t* end = src + length;
+
+    if (length > MATCH_LIMIT) {
+        // Positions of the last 4-byte sequences seen, relative to src
+        static thread_local uint32_t table[1 << HASH_BITS];
+        memset(table, 0, sizeof(table));
+
+        const uint8_t* ip = src + 1;
+        const uint8_t* matchLimit = end - MATCH_LIMIT;
+        const uint8_t* extendLimit = end - LAST_LITERALS;
+
+        while (ip < matchLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t h = hash4(sequence);
+            const uint8_t* ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+
+            if ((size_t)(ip - ref) > MAX_OFFSET || read32(ref) != sequence) {
+                // Step faster through data that does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            const uint8_t* matchEnd = extendMatch(ip + MIN_MATCH, ref + MIN_MATCH, extendLimit);
+            size_t literals = (size_t)(ip - anchor);
+            size_t matchLength = (size_t)(matchEnd - ip) - MIN_MATCH;
+
+            uint8_t* token = op++;
+            *token = (uint8_t)((literals >= 15 ? 15 : literals) << 4 | (matchLength >= 15 ? 15 : matchLength));
+            if (literals >= 15) op = writeLength(op, literals - 15);
+            memcpy(op, anchor, literals);
+            op += literals;
+            size_t offset = (size_t)(ip - ref);
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+            if (matchLength >= 15) op = writeLength(op, matchLength - 15);
+
+            ip = matchEnd;
+            anchor = ip;
+            // Index a position inside the match so runs keep matching
+            if (ip < matchLimit) {
+                table[hash4(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+            }
+        }
+    }
+
+    size_t literals = (size_t)(end - anchor);
+    *op++ = (uint8_t)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15) op = writeLength(op, literals - 15);
+    memcpy(op, anchor, literals);
+    op += literals;
+    return (size_t)(op - dst);
+}
+
+bool CompressedFile::decompressBlock(const uint8_t* src, size_t length, uint8_t* dst, size_t rawLength)
+{
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + length;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + rawLength;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return false;
+                b = *ip++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) return false;
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == iend) break;  // The last sequence has no match
+
+        if (iend - ip < 2) return false;
+        size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return false;
+                b = *ip++;
+                matchLength += b;
+            } while (b == 255);
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > (size_t)(oend - op)) return false;
+
+        const uint8_t* ref = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, ref, matchLength);
+        } else {
+            // Overlapping copy repeats the last offset bytes
+            for (size_t i = 0; i < matchLength; i++) op[i] = ref[i];
+        }
+        op += matchLength;
+    }
+    return op == oend;
+}
+
+bool CompressedFile::sniff(const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    if (!f) return false;
+    uint8_t head[sizeof(MAGIC)];
+    bool match = fread(head, 1, sizeof(head), f) == sizeof(head) && memcmp(head, MAGIC, sizeof(MAGIC)) == 0;
+    fclose(f);
+    return match;
+}
+
+CompressedFile::CompressedFile(const char* filename, const char* mode, size_t blockSize)
+{
+    _blockSize = blockSize ? blockSize : DEFAULT_BLOCK_SIZE;
+
+    if (strchr(mode, 'r')) {
+        _file = fopen(filename, "rb");
+        if (!_file) return;
+        if (!indexBlocks()) {
+            // Not written by us: pass the bytes through
+            _compressed = false;
+            fseek(_file, 0, SEEK_END);
+            long end = ftell(_file);
+            _size = _storedSize = end > 0 ? (uint64_t)end : 0;
+            fseek(_file, 0, SEEK_SET);
+        }
+        _stats = IoStats::forPath(filename);
+        return;
+    }
+
+    _writing = true;
+    bool append = strchr(mode, 'a') != nullptr;
+    std::error_code ec;
+    bool existing = append && std::filesystem::file_size(filename, ec) > 0 && !ec;
+
+    if (existing) {
+        _file = fopen(filename, "rb");
+        if (!_file) return;
+        bool ours = indexBlocks();
+        fclose(_file);
+        _file = nullptr;
+        if (!ours) {
+            fprintf(stderr, "CompressedFile: cannot append to uncompressed file %s\n", filename);
+            return;
+        }
+        // Cut off a torn final block before appending after it
+        if (std::filesystem::file_size(filename, ec) > _storedSize) {
+            std::filesystem::resize_file(filename, _storedSize, ec);
+        }
+        _file = fopen(filename, "ab");
+        if (!_file) return;
+        _pos = _size;
+        _blocks.clear();
+    } else {
+        _file = fopen(filename, "wb");
+        if (!_file) return;
+        uint8_t header[FILE_HEADER_SIZE];
+        memcpy(header, MAGIC, sizeof(MAGIC));
+        putLE32(header + sizeof(MAGIC), (uint32_t)_blockSize);
+        fwrite(header, 1, sizeof(header), _file);
+        _storedSize = sizeof(header);
+    }
+
+    _raw.reserve(_blockSize);
+    _packed.resize(maxCompressedSize(_blockSize));
+    _stats = IoStats::forPath(filename);
+}
+
+CompressedFile::~CompressedFile()
+{
+    close();
+}
+
+bool CompressedFile::indexBlocks()
+{
+    uint8_t header[FILE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), _file) != sizeof(header) || memcmp(header, MAGIC, sizeof(MAGIC)) != 0) {
+        fseek(_file, 0, SEEK_SET);
+        return false;
+    }
+    uint32_t blockSize = getLE32(header + sizeof(MAGIC));
+    if (blockSize == 0 || blockSize > MAX_BLOCK_SIZE) {
+        fseek(_file, 0, SEEK_SET);
+        return false;
+    }
+    _blockSize = blockSize;
+
+    fseek(_file, 0, SEEK_END);
+    uint64_t fileSize = (uint64_t)ftell(_file);
+    uint64_t offset = FILE_HEADER_SIZE;
+    _blocks.clear();
+    _size = 0;
+
+    while (offset + BLOCK_HEADER_SIZE <= fileSize) {
+        uint8_t blockHeader[BLOCK_HEADER_SIZE];
+        fseek(_file, (long)offset, SEEK_SET);
+        if (fread(blockHeader, 1, sizeof(blockHeader), _file) != sizeof(blockHeader)) break;
+        uint32_t rawLength = getLE32(blockHeader);
+        uint32_t storedLength = getLE32(blockHeader + 4);
+        if (rawLength > _blockSize || storedLength > maxCompressedSize(rawLength) ||
+            offset + BLOCK_HEADER_SIZE + storedLength > fileSize) {
+            break;  // Torn or corrupt tail
+        }
+        _blocks.push_back(Block{_size, offset, rawLength, storedLength});
+        _size += rawLength;
+        offset += BLOCK_HEADER_SIZE + storedLength;
+    }
+    _storedSize = offset;
+    _packed.resize(maxCompressedSize(_blockSize));
+    return true;
+}
+
+bool CompressedFile::writeBlock()
+{
+    if (_raw.empty()) return true;
+
+    size_t rawLength = _raw.size();
+    size_t packedLength = compressBlock(_raw.data(), rawLength, _packed.data());
+    bool stored = packedLength >= rawLength;
+    const uint8_t* payload = stored ? _raw.data() : _packed.data();
+    uint32_t payloadLength = (uint32_t)(stored ? rawLength : packedLength);
+
+    uint8_t header[BLOCK_HEADER_SIZE];
+    putLE32(header, (uint32_t)rawLength);
+    putLE32(header + 4, payloadLength);
+    bool written = fwrite(header, 1, sizeof(header), _file) == sizeof(header) &&
+                   fwrite(payload, 1, payloadLength, _file) == payloadLength;
+    _storedSize += sizeof(header) + payloadLength;
+    _raw.clear();
+    return written;
+}
+
+bool CompressedFile::loadBlock(size_t index)
+{
+    if (index == _cachedBlock) return true;
+
+    const Block& block = _blocks[index];
+    _raw.resize(block.rawLength);
+    if (fseek(_file, (long)(block.fileOffset + BLOCK_HEADER_SIZE), SEEK_SET) != 0) return false;
+
+    bool ok;
+    if (block.storedLength == block.rawLength) {
+        ok = fread(_raw.data(), 1, block.rawLength, _file) == block.rawLength;
+    } else {
+        ok = fread(_packed.data(), 1, block.storedLength, _file) == block.storedLength &&
+             decompressBlock(_packed.data(), block.storedLength, _raw.data(), block.rawLength);
+    }
+    if (!ok) {
+        fprintf(stderr, "CompressedFile: corrupt block at offset %llu\n", (unsigned long long)block.fileOffset);
+        _cachedBlock = SIZE_MAX;
+        return false;
+    }
+    _cachedBlock = index;
+    return true;
+}
+
+size_t CompressedFile::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t CompressedFile::write(const uint8_t *buffer, size_t size) {
+    if (!_file || !_writing) return 0;
+    size_t done = 0;
+    while (done < size) {
+        size_t chunk = std::min(_blockSize - _raw.size(), size - done);
+        _raw.insert(_raw.end(), buffer + done, buffer + done + chunk);
+        done += chunk;
+        if (_raw.size() == _blockSize && !writeBlock()) break;
+    }
+    _size += done;
+    _pos = _size;
+    _stats->recordWrite(size);
+    return done;
+}
+
+bool CompressedFile::flush() {
+    if (!_file) return false;
+    if (!_writing) return true;
+    auto start = std::chrono::steady_clock::now();
+    bool flushed = writeBlock() && fflush(_file) == 0;
+    _stats->recordFlush((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    return flushed;
+}
+
+int CompressedFile::read() {
+    uint8_t b;
+    return readBytes(&b, 1) == 1 ? b : -1;
+}
+
+int CompressedFile::readBytes(uint8_t *buffer, size_t length) {
+    if (!_file || _writing) return 0;
+
+    if (!_compressed) {
+        size_t n = fread(buffer, 1, length, _file);
+        _pos += n;
+        _stats->recordRead(n);
+        return (int)n;
+    }
+
+    size_t done = 0;
+    while (done < length && _pos < _size) {
+        size_t index = _cachedBlock;
+        if (index == SIZE_MAX || _pos < _blocks[index].rawOffset ||
+            _pos >= _blocks[index].rawOffset + _blocks[index].rawLength) {
+            // Last block starting at or before _pos
+            auto it = std::upper_bound(_blocks.begin(), _blocks.end(), _pos,
+                                       [](uint64_t pos, const Block& b) { return pos < b.rawOffset; });
+            index = (size_t)(it - _blocks.begin()) - 1;
+            if (!loadBlock(index)) break;
+        }
+        const Block& block = _blocks[index];
+        size_t within = (size_t)(_pos - block.rawOffset);
+        size_t chunk = std::min(length - done, (size_t)block.rawLength - within);
+        memcpy(buffer + done, _raw.data() + within, chunk);
+        done += chunk;
+        _pos += chunk;
+    }
+    _stats->recordRead(done);
+    return (int)done;
+}
+
+int CompressedFile::available() {
+    if (!_file) return 0;
+    return _size > _pos ? (int)(_size - _pos) : 0;
+}
+
+bool CompressedFile::seek(uint32_t pos) {
+    if (!_file) return false;
+    if (_writing) return pos == _pos;
+    if (!_compressed && fseek(_file, pos, SEEK_SET) != 0) return false;
+    _pos = pos;
+    return true;
+}
+
+uint32_t CompressedFile::position() {
+    return _file ? (uint32_t)_pos : 0;
+}
+
+uint32_t CompressedFile::size() {
+    return _file ? (uint32_t)_size : 0;
+}
+
+bool CompressedFile::close() {
+    if (!_file) return false;
+    bool written = !_writing || writeBlock();
+    bool closed = fclose(_file) == 0;
+    _file = nullptr;
+    return written && closed;
+}
+
+bool CompressedFile::isOpen() const {
+    return _file != nullptr;
+}
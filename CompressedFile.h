@@ -0,0 +1,122 @@
+#ifndef COMPRESSED_FILE_H
+#define COMPRESSED_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "RecordData/Storage/IFile.h"
+#include "IoStats.h"
+
+/**
+ * CompressedFile: IFile storing its data as independently compressed blocks
+ *
+ * Writes are buffered into blocks of blockSize bytes, and each full block is
+ * compressed with a small LZ77 codec (LZ4-style greedy matching, one hash
+ * probe per position) and appended to the file. Blocks that do not shrink
+ * are stored as-is. flush() writes the partial block, so frequent flushes
+ * cost compression ratio.
+ *
+ * File layout: an 8-byte MAGIC and a u32 block size, then per block a u32
+ * uncompressed length, a u32 stored length and the payload (little-endian).
+ *
+ * Readers index the block headers when opening, and seek() only decompresses
+ * the block holding the new position. A torn final block (crash during a
+ * write) is ignored, and appending cuts it off first. Opening a file without
+ * MAGIC for reading passes its bytes through unchanged, so readers need not
+ * know how a log was written.
+ */
+class CompressedFile : public astra::IFile
+{
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+    static const uint8_t MAGIC[8];
+
+    /**
+     * @param filename Host path
+     * @param mode "rb", "wb" or "ab"
+     * @param blockSize Uncompressed block size for new files
+     */
+    CompressedFile(const char* filename, const char* mode, size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~CompressedFile();
+
+    CompressedFile(const CompressedFile&) = delete;
+    CompressedFile& operator=(const CompressedFile&) = delete;
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    bool flush() override;
+
+    int read() override;
+    int readBytes(uint8_t *buffer, size_t length) override;
+    int available() override;
+
+    bool seek(uint32_t pos) override;  // Readers only
+    uint32_t position() override;
+    uint32_t size() override;          // Uncompressed size
+    bool close() override;
+
+    bool isOpen() const override;
+
+    /**
+     * False when reading a file without MAGIC (bytes are passed through)
+     */
+    bool isCompressed() const { return _compressed; }
+
+    /**
+     * Bytes the file takes on disk
+     */
+    uint64_t storedSize() const { return _storedSize; }
+
+    IoStats* stats() const { return _stats.get(); }
+
+    /**
+     * True if the file at this path starts with MAGIC
+     */
+    static bool sniff(const char* filename);
+
+    /**
+     * Compress one block
+     * @param dst Must hold maxCompressedSize(length) bytes
+     * @return Compressed size
+     */
+    static size_t compressBlock(const uint8_t* src, size_t length, uint8_t* dst);
+    static size_t maxCompressedSize(size_t length) { return length + length / 255 + 16; }
+
+    /**
+     * Decompress one block
+     * @return false if the input is corrupt or does not decode to exactly rawLength bytes
+     */
+    static bool decompressBlock(const uint8_t* src, size_t length, uint8_t* dst, size_t rawLength);
+
+private:
+    struct Block {
+        uint64_t rawOffset;   // Uncompressed offset of the first byte
+        uint64_t fileOffset;  // Offset of the block header
+        uint32_t rawLength;
+        uint32_t storedLength;
+    };
+
+    bool indexBlocks();
+    bool writeBlock();
+    bool loadBlock(size_t index);
+
+    FILE* _file = nullptr;
+    bool _writing = false;
+    bool _compressed = true;
+    size_t _blockSize = DEFAULT_BLOCK_SIZE;
+
+    uint64_t _pos = 0;
+    uint64_t _size = 0;
+    uint64_t _storedSize = 0;
+
+    std::vector<uint8_t> _raw;        // Block being written, or the cached decoded block
+    std::vector<uint8_t> _packed;     // Compressed bytes
+    std::vector<Block> _blocks;
+    size_t _cachedBlock = SIZE_MAX;   // Index of the block decoded in _raw
+
+    std::shared_ptr<IoStats> _stats;
+};
+
+#endif // COMPRESSED_FILE_H
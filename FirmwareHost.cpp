@@ -0,0 +1,129 @@
+#include "FirmwareHost.h"
+#include "NativeRuntime.h"
+#include "FlightRecorder.h"
+
+FirmwareHost::FirmwareHost(unsigned threads, uint64_t tickMicros)
+    : threadCount(threads), tickMicros(tickMicros ? tickMicros : 1)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+    }
+    // The calling thread works too, so spawn one fewer
+    for (unsigned i = 1; i < threadCount; i++) {
+        workers.emplace_back(&FirmwareHost::workerMain, this);
+    }
+}
+
+FirmwareHost::~FirmwareHost()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+FirmwareInstance& FirmwareHost::addInstance(const char* name, FirmwareInstance::EntryPoint setupFn,
+                                            FirmwareInstance::EntryPoint loopFn)
+{
+    instances.emplace_back(new FirmwareInstance(name, setupFn, loopFn));
+    return *instances.back();
+}
+
+void FirmwareHost::linkSerial(FirmwareInstance& a, int portA, FirmwareInstance& b, int portB)
+{
+    a.world.linkSerial(portA, b.world, portB);
+}
+
+void FirmwareHost::setup()
+{
+    dispatch(PHASE_SETUP);
+    for (auto& inst : instances) {
+        inst->world.commitChannels();
+    }
+}
+
+void FirmwareHost::step()
+{
+    dispatch(PHASE_LOOP);
+    // Barrier reached: no instance is running, so links and clocks can move
+    for (auto& inst : instances) {
+        inst->world.commitChannels();
+        inst->world.advanceMicros(tickMicros);
+    }
+    tickCount++;
+}
+
+void FirmwareHost::run(uint64_t ticks)
+{
+    for (uint64_t i = 0; (ticks == 0 || i < ticks) && !nativeShutdownRequested(); i++) {
+        step();
+    }
+}
+
+void FirmwareHost::dispatch(Phase newPhase)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        phase = newPhase;
+        nextInstance.store(0);
+        busyWorkers = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(newPhase);
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this] { return busyWorkers == 0; });
+}
+
+void FirmwareHost::drain(Phase current)
+{
+    while (true) {
+        size_t i = nextInstance.fetch_add(1);
+        if (i >= instances.size()) {
+            return;
+        }
+        FirmwareInstance& inst = *instances[i];
+        MockWorldScope scope(inst.world);
+        if (current == PHASE_SETUP) {
+            if (inst.setupFn) inst.setupFn();
+        } else {
+            FlightRecorder::recordLoop(inst.loopCount);
+            if (inst.loopFn) inst.loopFn();
+            inst.loopCount++;
+        }
+    }
+}
+
+void FirmwareHost::workerMain()
+{
+    uint64_t seen = 0;
+    while (true) {
+        Phase current;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            current = phase;
+        }
+
+        drain(current);
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            busyWorkers--;
+        }
+        done.notify_one();
+    }
+}
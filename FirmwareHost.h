@@ -0,0 +1,121 @@
+#ifndef FIRMWARE_HOST_H
+#define FIRMWARE_HOST_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MockWorld.h"
+
+/**
+ * FirmwareInstance: One simulated flight computer
+ *
+ * Pairs a setup()/loop() entry point with its own MockWorld. Mocks are
+ * isolated per instance; globals defined by the firmware itself are not, so
+ * instances sharing the same entry points must keep their state in objects
+ * reachable from the world (e.g. keyed by MockWorld::current()).
+ */
+class FirmwareInstance
+{
+public:
+    typedef void (*EntryPoint)();
+
+    FirmwareInstance(const char* name, EntryPoint setupFn, EntryPoint loopFn)
+        : world(name), setupFn(setupFn), loopFn(loopFn) {}
+
+    const char* name() const { return world.name(); }
+    uint64_t iterations() const { return loopCount; }
+
+    MockWorld world;
+
+private:
+    friend class FirmwareHost;
+    EntryPoint setupFn;
+    EntryPoint loopFn;
+    uint64_t loopCount = 0;
+};
+
+/**
+ * FirmwareHost: Runs several firmware instances in one process
+ *
+ * Instances advance in lockstep ticks. Each tick runs loop() once for every
+ * instance, spread over a fixed pool of worker threads, then commits the
+ * in-memory serial links and advances every instance's virtual clock by the
+ * tick period. An instance is only ever stepped by one thread at a time.
+ */
+class FirmwareHost
+{
+public:
+    /**
+     * @param threads Worker threads, including the caller; 0 picks the core count
+     * @param tickMicros Virtual time added to every instance per tick
+     */
+    explicit FirmwareHost(unsigned threads = 0, uint64_t tickMicros = 1000);
+    ~FirmwareHost();
+
+    FirmwareHost(const FirmwareHost&) = delete;
+    FirmwareHost& operator=(const FirmwareHost&) = delete;
+
+    /**
+     * Add a firmware instance (must be called before setup())
+     * @return The new instance, owned by the host
+     */
+    FirmwareInstance& addInstance(const char* name, FirmwareInstance::EntryPoint setupFn,
+                                  FirmwareInstance::EntryPoint loopFn);
+
+    /**
+     * Connect a serial port of one instance to a serial port of another
+     * @param port 0 for Serial, 1..3 for Serial1..Serial3
+     */
+    void linkSerial(FirmwareInstance& a, int portA, FirmwareInstance& b, int portB);
+
+    /**
+     * Run setup() for every instance
+     */
+    void setup();
+
+    /**
+     * Run one lockstep tick
+     */
+    void step();
+
+    /**
+     * Run a number of ticks (0 runs until a native shutdown is requested)
+     */
+    void run(uint64_t ticks = 0);
+
+    size_t instanceCount() const { return instances.size(); }
+    FirmwareInstance& instance(size_t i) { return *instances[i]; }
+    uint64_t ticks() const { return tickCount; }
+    void setTickMicros(uint64_t us) { tickMicros = us ? us : 1; }
+    uint64_t tickPeriodMicros() const { return tickMicros; }
+
+private:
+    enum Phase { PHASE_SETUP, PHASE_LOOP };
+
+    void dispatch(Phase phase);
+    void drain(Phase phase);
+    void workerMain();
+
+    std::vector<std::unique_ptr<FirmwareInstance>> instances;
+    std::vector<std::thread> workers;
+    unsigned threadCount;
+    uint64_t tickMicros;
+    uint64_t tickCount = 0;
+
+    // Work distribution for the current phase
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::atomic<size_t> nextInstance{0};
+    size_t busyWorkers = 0;
+    uint64_t generation = 0;
+    Phase phase = PHASE_LOOP;
+    bool stopping = false;
+};
+
+#endif // FIRMWARE_HOST_H
@@ -0,0 +1,175 @@
+#include "FlightRecorder.h"
+#include "Arduino.h"
+#include <atomic>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#define WRITE_FD _write
+#else
+#include <unistd.h>
+#define WRITE_FD ::write
+#endif
+
+struct FlightRecord {
+    std::atomic<uint64_t> sequence;  // Index + 1 once the record is complete
+    uint64_t micros;
+    int32_t a;
+    int32_t b;
+    uint8_t type;
+    uint8_t textLen;
+    char text[FlightRecorder::TEXT_SIZE];
+};
+
+static FlightRecord records[FlightRecorder::CAPACITY];
+static std::atomic<uint64_t> head(0);
+
+static FlightRecord& claim(uint64_t& index)
+{
+    index = head.fetch_add(1, std::memory_order_relaxed);
+    FlightRecord& rec = records[index & (FlightRecorder::CAPACITY - 1)];
+    rec.sequence.store(0, std::memory_order_relaxed);
+    return rec;
+}
+
+static void publish(FlightRecord& rec, uint64_t index)
+{
+    rec.sequence.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::recordSerialLine(const char* text, size_t len)
+{
+    uint64_t index;
+    FlightRecord& rec = claim(index);
+    if (len > TEXT_SIZE - 1) {
+        len = TEXT_SIZE - 1;
+    }
+    rec.type = SERIAL_LINE;
+    rec.micros = micros();
+    rec.textLen = (uint8_t)len;
+    memcpy(rec.text, text, len);
+    publish(rec, index);
+}
+
+void FlightRecorder::recordPin(int pin, int value)
+{
+    uint64_t index;
+    FlightRecord& rec = claim(index);
+    rec.type = PIN_CHANGE;
+    rec.micros = micros();
+    rec.a = pin;
+    rec.b = value;
+    publish(rec, index);
+}
+
+void FlightRecorder::recordLoop(uint64_t iteration)
+{
+    uint64_t index;
+    FlightRecord& rec = claim(index);
+    rec.type = LOOP_START;
+    rec.micros = micros();
+    rec.a = (int32_t)(iteration >> 32);
+    rec.b = (int32_t)(iteration & 0xffffffffu);
+    publish(rec, index);
+}
+
+void FlightRecorder::writeText(int fd, const char* text)
+{
+    size_t len = strlen(text);
+    while (len > 0) {
+        long n = (long)WRITE_FD(fd, text, (unsigned)len);
+        if (n <= 0) {
+            return;
+        }
+        text += n;
+        len -= (size_t)n;
+    }
+}
+
+void FlightRecorder::writeDecimal(int fd, uint64_t value)
+{
+    char buf[24];
+    int pos = (int)sizeof(buf) - 1;
+    buf[pos] = '\0';
+    do {
+        buf[--pos] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value && pos > 0);
+    writeText(fd, buf + pos);
+}
+
+void FlightRecorder::writeHex(int fd, uint64_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    char buf[19];
+    int pos = (int)sizeof(buf) - 1;
+    buf[pos] = '\0';
+    do {
+        buf[--pos] = digits[value & 0xf];
+        value >>= 4;
+    } while (value && pos > 2);
+    buf[--pos] = 'x';
+    buf[--pos] = '0';
+    writeText(fd, buf + pos);
+}
+
+// Seconds with 6 decimals, without floating point
+static void writeTimestamp(int fd, uint64_t us)
+{
+    char frac[8];
+    uint64_t rem = us % 1000000;
+    for (int i = 5; i >= 0; i--) {
+        frac[i] = (char)('0' + rem % 10);
+        rem /= 10;
+    }
+    frac[6] = '\0';
+    FlightRecorder::writeText(fd, "[");
+    FlightRecorder::writeDecimal(fd, us / 1000000);
+    FlightRecorder::writeText(fd, ".");
+    FlightRecorder::writeText(fd, frac);
+    FlightRecorder::writeText(fd, "] ");
+}
+
+void FlightRecorder::dump(int fd)
+{
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+
+    writeText(fd, "FLIGHT RECORDER (last ");
+    writeDecimal(fd, end - begin);
+    writeText(fd, " of ");
+    writeDecimal(fd, end);
+    writeText(fd, " events)\n");
+
+    for (uint64_t i = begin; i < end; i++) {
+        const FlightRecord& rec = records[i & (CAPACITY - 1)];
+        // Skip records still being written or already overwritten
+        if (rec.sequence.load(std::memory_order_acquire) != i + 1) {
+            continue;
+        }
+        writeTimestamp(fd, rec.micros);
+        switch (rec.type) {
+        case SERIAL_LINE: {
+            char line[TEXT_SIZE + 1];
+            memcpy(line, rec.text, rec.textLen);
+            line[rec.textLen] = '\0';
+            writeText(fd, "SERIAL ");
+            writeText(fd, line);
+            break;
+        }
+        case PIN_CHANGE:
+            writeText(fd, "PIN ");
+            writeDecimal(fd, (uint64_t)rec.a);
+            writeText(fd, rec.b == LOW ? " LOW" : " HIGH");
+            break;
+        case LOOP_START:
+            writeText(fd, "LOOP #");
+            writeDecimal(fd, ((uint64_t)(uint32_t)rec.a << 32) | (uint32_t)rec.b);
+            break;
+        default:
+            writeText(fd, "?");
+            break;
+        }
+        writeText(fd, "\n");
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * FlightRecorder: Lock-free in-memory ring of recent firmware activity
+ *
+ * Keeps the last CAPACITY events - serial lines, digitalWrite() pin changes
+ * and loop() iteration timestamps - in a fixed static array. Recording is a
+ * single atomic fetch_add plus a few stores, with no locks or allocation,
+ * and is safe from any thread.
+ *
+ * dump() only uses write(2) and never allocates, so the crash handler in
+ * ArduinoMain.cpp can call it from a signal handler to show what led up to
+ * the crash.
+ */
+class FlightRecorder
+{
+public:
+    static const size_t CAPACITY = 1024;  // Power of two
+    static const size_t TEXT_SIZE = 40;
+
+    enum Type : uint8_t {
+        SERIAL_LINE = 1,
+        PIN_CHANGE = 2,
+        LOOP_START = 3,
+    };
+
+    /**
+     * Record a line written to a mock serial port (truncated to TEXT_SIZE - 1)
+     */
+    static void recordSerialLine(const char* text, size_t len);
+
+    static void recordPin(int pin, int value);
+
+    static void recordLoop(uint64_t iteration);
+
+    /**
+     * Write the recorded events, oldest first (async-signal-safe)
+     * @param fd File descriptor, e.g. 2 for stderr
+     */
+    static void dump(int fd);
+
+    // Async-signal-safe output helpers shared with the crash handler
+    static void writeText(int fd, const char* text);
+    static void writeDecimal(int fd, uint64_t value);
+    static void writeHex(int fd, uint64_t value);
+};
+
+#endif // FLIGHT_RECORDER_H
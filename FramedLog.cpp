@@ -0,0 +1,203 @@
+#include "FramedLog.h"
+#include "MockStorage.h"
+#include <algorithm>
+#include <cstring>
+
+const uint8_t FrameWriter::INDEX_MAGIC[8] = {'N', 'T', 'I', 'D', 'X', '1', '\r', '\n'};
+
+// Reflected CRC-32 (IEEE, as in zlib)
+static const uint32_t* crcTable() {
+    static uint32_t table[256];
+    static bool ready = [] {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+uint32_t FrameWriter::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    const uint32_t* table = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// FrameWriter implementation
+FrameWriter::FrameWriter(uint64_t indexInterval)
+    : _interval(indexInterval ? indexInterval : DEFAULT_INDEX_INTERVAL) {}
+
+FrameWriter::~FrameWriter() {
+    close();
+}
+
+bool FrameWriter::open(const std::string& dataPath, uint64_t offset) {
+    close();
+    _offset = offset;
+    _nextIndexAt = offset;
+    std::string path = indexPathFor(dataPath);
+    // A fresh data file makes the old entries meaningless
+    _index = fopen(path.c_str(), offset ? "ab" : "wb");
+    if (!_index) {
+        fprintf(stderr, "FrameWriter: cannot open %s\n", path.c_str());
+        return false;
+    }
+    fseek(_index, 0, SEEK_END);
+    if (ftell(_index) == 0) fwrite(INDEX_MAGIC, 1, sizeof(INDEX_MAGIC), _index);
+    return true;
+}
+
+void FrameWriter::close() {
+    if (_index) {
+        fclose(_index);
+        _index = nullptr;
+    }
+}
+
+void FrameWriter::flush() {
+    if (_index) fflush(_index);
+}
+
+void FrameWriter::frame(const uint8_t* payload, size_t length, uint64_t micros, uint8_t header[HEADER_SIZE]) {
+    uint32_t sync = SYNC;
+    uint32_t len = (uint32_t)length;
+    memcpy(header, &sync, 4);
+    memcpy(header + 4, &len, 4);
+    memcpy(header + 8, &micros, 8);
+    uint32_t crc = crc32(payload, length, crc32(header + 4, 12));
+    memcpy(header + 16, &crc, 4);
+
+    if (_index && _offset >= _nextIndexAt) {
+        TimeIndexEntry entry = { micros, _offset };
+        fwrite(&entry, sizeof(entry), 1, _index);
+        _nextIndexAt = _offset + _interval;
+    }
+    _offset += HEADER_SIZE + length;
+}
+
+// FramedLogReader implementation
+FramedLogReader::FramedLogReader(const std::string& path)
+    : _file(new MockFile(path.c_str(), "rbm")) {
+    if (!_file->isOpen()) return;
+    _data = _file->mappedData();
+    _size = _file->mappedSize();
+
+    FILE* index = fopen(FrameWriter::indexPathFor(path).c_str(), "rb");
+    if (!index) return;  // Queries still work, by scanning from the start
+    uint8_t magic[sizeof(FrameWriter::INDEX_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), index) == sizeof(magic) &&
+        memcmp(magic, FrameWriter::INDEX_MAGIC, sizeof(magic)) == 0) {
+        TimeIndexEntry entry;
+        while (fread(&entry, sizeof(entry), 1, index) == 1) {
+            if (entry.offset < _size) _index.push_back(entry);
+        }
+    }
+    fclose(index);
+}
+
+FramedLogReader::~FramedLogReader() = default;
+
+bool FramedLogReader::ok() const {
+    return _file && _file->isOpen();
+}
+
+bool FramedLogReader::parse(uint64_t pos, FramedRecord& record) const {
+    if (pos + FrameWriter::HEADER_SIZE > _size) return false;
+    const uint8_t* p = _data + pos;
+    uint32_t sync, length, crc;
+    memcpy(&sync, p, 4);
+    if (sync != FrameWriter::SYNC) return false;
+    memcpy(&length, p + 4, 4);
+    if (length > _size - pos - FrameWriter::HEADER_SIZE) return false;
+    memcpy(&crc, p + 16, 4);
+    const uint8_t* payload = p + FrameWriter::HEADER_SIZE;
+    if (FrameWriter::crc32(payload, length, FrameWriter::crc32(p + 4, 12)) != crc) return false;
+    memcpy(&record.micros, p + 8, 8);
+    record.offset = pos;
+    record.data = payload;
+    record.length = length;
+    return true;
+}
+
+bool FramedLogReader::nextFrom(uint64_t& pos, FramedRecord& record) {
+    while (pos + FrameWriter::HEADER_SIZE <= _size) {
+        if (parse(pos, record)) {
+            pos += FrameWriter::HEADER_SIZE + record.length;
+            _scanned++;
+            return true;
+        }
+        // Resynchronise on the next possible SYNC
+        const uint8_t first = (uint8_t)(FrameWriter::SYNC & 0xff);
+        const void* hit = memchr(_data + pos + 1, first, (size_t)(_size - pos - 1));
+        uint64_t next = hit ? (uint64_t)((const uint8_t*)hit - _data) : _size;
+        _skipped += next - pos;
+        pos = next;
+    }
+    if (pos < _size) {
+        _skipped += _size - pos;  // Torn tail
+        pos = _size;
+    }
+    return false;
+}
+
+bool FramedLogReader::next(FramedRecord& record) {
+    return nextFrom(_pos, record);
+}
+
+// Offset of a verified record from which a forward scan reaches every record
+// with a timestamp >= micros (> micros unless inclusive)
+uint64_t FramedLogReader::startBefore(uint64_t micros, bool inclusive) {
+    auto end = inclusive
+        ? std::upper_bound(_index.begin(), _index.end(), micros,
+                           [](uint64_t t, const TimeIndexEntry& e) { return t < e.micros; })
+        : std::lower_bound(_index.begin(), _index.end(), micros,
+                           [](const TimeIndexEntry& e, uint64_t t) { return e.micros < t; });
+    // Entries are only hints: use the latest one that points at an intact record
+    FramedRecord record;
+    for (auto it = end; it != _index.begin();) {
+        --it;
+        if (parse(it->offset, record) && record.micros == it->micros) return it->offset;
+    }
+    return 0;
+}
+
+bool FramedLogReader::seek(uint64_t micros) {
+    uint64_t pos = startBefore(micros, false);
+    FramedRecord record;
+    while (nextFrom(pos, record)) {
+        if (record.micros >= micros) {
+            _pos = record.offset;
+            return true;
+        }
+    }
+    _pos = _size;
+    return false;
+}
+
+bool FramedLogReader::at(uint64_t micros, FramedRecord& record) {
+    uint64_t pos = startBefore(micros, true);
+    FramedRecord candidate;
+    bool found = false;
+    while (nextFrom(pos, candidate) && candidate.micros <= micros) {
+        record = candidate;
+        found = true;
+        _pos = pos;
+    }
+    return found;
+}
+
+std::vector<FramedRecord> FramedLogReader::between(uint64_t fromMicros, uint64_t toMicros) {
+    std::vector<FramedRecord> records;
+    if (!seek(fromMicros)) return records;
+    FramedRecord record;
+    while (next(record) && record.micros <= toMicros) {
+        records.push_back(record);
+    }
+    return records;
+}
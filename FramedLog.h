@@ -0,0 +1,172 @@
+#ifndef FRAMED_LOG_H
+#define FRAMED_LOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MockFile;
+
+/**
+ * Framed logs: every record carries its length, a micros() timestamp and a
+ * CRC, and a sparse side index maps timestamps to file offsets, so a reader
+ * can find "the state at t=42.3 s" with a binary search and a short scan.
+ *
+ * Record layout (little-endian):
+ *   u32 SYNC, u32 length, u64 micros, u32 crc32(length, micros, payload), payload
+ *
+ * The index "<file>.tidx" starts with an 8-byte INDEX_MAGIC and holds
+ * { u64 micros, u64 offset } for the first record written after every
+ * indexInterval bytes. Entries are hints: a reader checks the record they
+ * point at and falls back to an earlier entry (or the file start) if it is
+ * missing or damaged.
+ *
+ * Timestamps are expected not to decrease within one file.
+ */
+
+struct TimeIndexEntry
+{
+    uint64_t micros;
+    uint64_t offset;
+};
+
+struct FramedRecord
+{
+    uint64_t micros = 0;
+    uint64_t offset = 0;          // Of the record header in the file
+    const uint8_t* data = nullptr;  // Payload, valid while the reader is alive
+    uint32_t length = 0;
+};
+
+/**
+ * FrameWriter: Builds record headers and maintains the time index
+ *
+ * Used by NativeFileLog and MockFile; the caller writes the header returned
+ * by frame() followed by the payload.
+ */
+class FrameWriter
+{
+public:
+    static const uint32_t SYNC = 0x4d52464e;  // "NFRM"
+    static const size_t HEADER_SIZE = 20;
+    static const uint64_t DEFAULT_INDEX_INTERVAL = 64 * 1024;
+    static const uint8_t INDEX_MAGIC[8];
+
+    explicit FrameWriter(uint64_t indexInterval = DEFAULT_INDEX_INTERVAL);
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    /**
+     * Start indexing a data file
+     * @param dataPath Data file; the index goes to dataPath + ".tidx"
+     * @param offset Current length of the data file (0 also empties the index)
+     */
+    bool open(const std::string& dataPath, uint64_t offset);
+    void close();
+
+    /**
+     * Flush buffered index entries (after the data they point at)
+     */
+    void flush();
+
+    /**
+     * Fill header for a record written at the current offset and advance it
+     */
+    void frame(const uint8_t* payload, size_t length, uint64_t micros, uint8_t header[HEADER_SIZE]);
+
+    uint64_t offset() const { return _offset; }
+
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+
+    static std::string indexPathFor(const std::string& dataPath) { return dataPath + ".tidx"; }
+
+private:
+    FILE* _index = nullptr;
+    uint64_t _interval;
+    uint64_t _offset = 0;
+    uint64_t _nextIndexAt = 0;
+};
+
+/**
+ * FramedLogReader: Time-range queries over a framed log
+ *
+ * Maps the file (MockFile mode "rbm") and loads its index. Damaged bytes are
+ * skipped by searching for the next record that passes its CRC.
+ *
+ * Example:
+ *   FramedLogReader log("flight.log");
+ *   FramedRecord r;
+ *   if (log.at(42300000, r)) ...              // Last record at or before 42.3 s
+ *   log.seek(10000000);
+ *   while (log.next(r) && r.micros < 20000000) ...
+ */
+class FramedLogReader
+{
+public:
+    explicit FramedLogReader(const std::string& path);
+    ~FramedLogReader();
+
+    FramedLogReader(const FramedLogReader&) = delete;
+    FramedLogReader& operator=(const FramedLogReader&) = delete;
+
+    bool ok() const;
+
+    /**
+     * Position next() at the first record with a timestamp >= micros
+     * @return false if there is no such record
+     */
+    bool seek(uint64_t micros);
+
+    /**
+     * Position next() at the first record
+     */
+    void rewind() { _pos = 0; }
+
+    /**
+     * Read the record at the current position and advance past it
+     * @return false at the end of the file
+     */
+    bool next(FramedRecord& record);
+
+    /**
+     * The last record with a timestamp <= micros
+     */
+    bool at(uint64_t micros, FramedRecord& record);
+
+    /**
+     * Records with timestamps in [fromMicros, toMicros], in file order
+     */
+    std::vector<FramedRecord> between(uint64_t fromMicros, uint64_t toMicros);
+
+    const std::vector<TimeIndexEntry>& index() const { return _index; }
+
+    /**
+     * Bytes skipped so far because they did not hold a valid record
+     */
+    uint64_t skippedBytes() const { return _skipped; }
+
+    /**
+     * Records decoded so far (a measure of how much a query had to scan)
+     */
+    uint64_t recordsScanned() const { return _scanned; }
+
+private:
+    bool parse(uint64_t pos, FramedRecord& record) const;
+    bool nextFrom(uint64_t& pos, FramedRecord& record);
+    uint64_t startBefore(uint64_t micros, bool inclusive);
+
+    std::unique_ptr<MockFile> _file;
+    const uint8_t* _data = nullptr;
+    uint64_t _size = 0;
+    uint64_t _pos = 0;
+    uint64_t _skipped = 0;
+    uint64_t _scanned = 0;
+    std::vector<TimeIndexEntry> _index;
+};
+
+#endif // FRAMED_LOG_H
@@ -0,0 +1,102 @@
+#include "IoStats.h"
+#include <cstdlib>
+#include <map>
+
+static std::mutex registryLock;
+static std::map<std::string, std::shared_ptr<IoStats>>* registry = nullptr;
+
+static void printAtExit()
+{
+    IoStats::printAll(stderr);
+}
+
+void IoStats::recordFlush(uint64_t ns)
+{
+    std::lock_guard<std::mutex> guard(flushLock);
+    flushHist.record(ns);
+}
+
+uint64_t IoStats::flushes()
+{
+    std::lock_guard<std::mutex> guard(flushLock);
+    return flushHist.count();
+}
+
+double IoStats::averageWriteSize() const
+{
+    uint64_t calls = writeCalls();
+    return calls ? (double)bytesWritten() / (double)calls : 0.0;
+}
+
+LatencyHistogram IoStats::flushLatencies()
+{
+    std::lock_guard<std::mutex> guard(flushLock);
+    return flushHist;
+}
+
+void IoStats::print(FILE* out)
+{
+    double average = averageWriteSize();
+    fprintf(out, "%s\n", filePath.c_str());
+    fprintf(out, "  written: %llu bytes in %llu calls (avg %.1f B, %llu single-byte)%s\n",
+            (unsigned long long)bytesWritten(), (unsigned long long)writeCalls(), average,
+            (unsigned long long)singleByteWrites(),
+            writeCalls() && average < 4.0 ? "  <-- tiny writes" : "");
+    if (readCalls()) {
+        fprintf(out, "  read: %llu bytes in %llu calls\n",
+                (unsigned long long)bytesRead(), (unsigned long long)readCalls());
+    }
+    std::lock_guard<std::mutex> guard(flushLock);
+    if (flushHist.count()) {
+        flushHist.print(out, "  flush()");
+    }
+}
+
+std::shared_ptr<IoStats> IoStats::forPath(const std::string& path)
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (!registry) {
+        registry = new std::map<std::string, std::shared_ptr<IoStats>>();
+        const char* env = getenv("NATIVE_IO_STATS");
+        if (env && env[0] && env[0] != '0') {
+            atexit(printAtExit);
+        }
+    }
+    std::shared_ptr<IoStats>& stats = (*registry)[path];
+    if (!stats) {
+        stats = std::make_shared<IoStats>(path);
+    }
+    return stats;
+}
+
+std::vector<std::shared_ptr<IoStats>> IoStats::all()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    std::vector<std::shared_ptr<IoStats>> list;
+    if (registry) {
+        for (auto& entry : *registry) {
+            list.push_back(entry.second);
+        }
+    }
+    return list;
+}
+
+void IoStats::printAll(FILE* out)
+{
+    std::vector<std::shared_ptr<IoStats>> list = all();
+    fprintf(out, "========================================\n");
+    fprintf(out, "FILE I/O (%zu paths)\n", list.size());
+    for (auto& stats : list) {
+        stats->print(out);
+    }
+    fprintf(out, "========================================\n");
+    fflush(out);
+}
+
+void IoStats::resetAll()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (registry) {
+        registry->clear();
+    }
+}
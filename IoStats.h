@@ -0,0 +1,93 @@
+#ifndef IO_STATS_H
+#define IO_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "LatencyHistogram.h"
+
+/**
+ * IoStats: I/O counters for one path, shared by every handle opened on it
+ *
+ * MockFile and NativeFileLog count each write() call and its size, reads,
+ * and flushes with their latency. The average write size makes drivers that
+ * write a byte at a time stand out immediately.
+ *
+ * Counters are atomics, so handles on different threads can share a path.
+ *
+ * Query them with forPath() or all(), or set NATIVE_IO_STATS=1 to print
+ * every path's counters at exit.
+ */
+class IoStats
+{
+public:
+    explicit IoStats(const std::string& path) : filePath(path) {}
+
+    void recordWrite(size_t bytes)
+    {
+        writeCallCount.fetch_add(1, std::memory_order_relaxed);
+        writtenBytes.fetch_add(bytes, std::memory_order_relaxed);
+        if (bytes == 1) {
+            singleByteCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void recordRead(size_t bytes)
+    {
+        readCallCount.fetch_add(1, std::memory_order_relaxed);
+        readBytesCount.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void recordFlush(uint64_t ns);
+
+    const std::string& path() const { return filePath; }
+    uint64_t bytesWritten() const { return writtenBytes.load(std::memory_order_relaxed); }
+    uint64_t writeCalls() const { return writeCallCount.load(std::memory_order_relaxed); }
+    uint64_t singleByteWrites() const { return singleByteCount.load(std::memory_order_relaxed); }
+    uint64_t bytesRead() const { return readBytesCount.load(std::memory_order_relaxed); }
+    uint64_t readCalls() const { return readCallCount.load(std::memory_order_relaxed); }
+    uint64_t flushes();
+    double averageWriteSize() const;
+
+    /**
+     * Copy of the flush latencies, in ns
+     */
+    LatencyHistogram flushLatencies();
+
+    void print(FILE* out);
+
+    /**
+     * Counters for a path, created on first use
+     */
+    static std::shared_ptr<IoStats> forPath(const std::string& path);
+
+    /**
+     * Every path seen so far, sorted by path
+     */
+    static std::vector<std::shared_ptr<IoStats>> all();
+
+    static void printAll(FILE* out);
+
+    /**
+     * Forget every path (handles still open keep their own counters)
+     */
+    static void resetAll();
+
+private:
+    std::string filePath;
+    std::atomic<uint64_t> writtenBytes{0};
+    std::atomic<uint64_t> writeCallCount{0};
+    std::atomic<uint64_t> singleByteCount{0};
+    std::atomic<uint64_t> readBytesCount{0};
+    std::atomic<uint64_t> readCallCount{0};
+
+    std::mutex flushLock;
+    LatencyHistogram flushHist;
+};
+
+#endif // IO_STATS_H
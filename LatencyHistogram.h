@@ -0,0 +1,133 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * LatencyHistogram: Fixed-size HDR-style (log-linear) histogram of durations
+ *
+ * Values are bucketed with 7 significant bits: 64 buckets per power of two,
+ * each at most 1/64 (about 1.6%) of the value wide, from 1 ns up to the full
+ * uint64_t range, in a flat array of counters. record() is a handful of
+ * integer ops and never allocates, so it is cheap enough to call on every
+ * loop iteration.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() { reset(); }
+
+    void reset()
+    {
+        memset(counts, 0, sizeof(counts));
+        total = 0;
+        sum = 0;
+        minValue = UINT64_MAX;
+        maxValue = 0;
+    }
+
+    void record(uint64_t value)
+    {
+        counts[bucketOf(value)]++;
+        total++;
+        sum += value;
+        if (value < minValue) minValue = value;
+        if (value > maxValue) maxValue = value;
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < BUCKETS; i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        if (other.minValue < minValue) minValue = other.minValue;
+        if (other.maxValue > maxValue) maxValue = other.maxValue;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? (double)sum / (double)total : 0.0; }
+
+    /**
+     * Value at or below which the given fraction of samples fall
+     * @param q Quantile in [0, 1], e.g. 0.99 for p99
+     * @return Upper bound of the matching bucket, clamped to the recorded max
+     */
+    uint64_t percentile(double q) const
+    {
+        if (total == 0) return 0;
+        if (q <= 0.0) return min();
+        uint64_t rank = (uint64_t)(q * (double)total + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > total) rank = total;
+
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t upper = bucketUpper(i);
+                return upper < maxValue ? upper : maxValue;
+            }
+        }
+        return maxValue;
+    }
+
+    /**
+     * Print count/min/mean/p50/p90/p99/p99.9/max, scaled by divisor
+     * @param label Prefix for the line
+     * @param divisor e.g. 1000.0 to print nanoseconds as microseconds
+     * @param unit Unit suffix printed after each value
+     */
+    void print(FILE* out, const char* label, double divisor = 1000.0, const char* unit = "us") const
+    {
+        fprintf(out, "%s: n=%llu min=%.1f%s mean=%.1f%s p50=%.1f%s p90=%.1f%s p99=%.1f%s p99.9=%.1f%s max=%.1f%s\n",
+                label, (unsigned long long)total,
+                min() / divisor, unit, mean() / divisor, unit,
+                percentile(0.50) / divisor, unit, percentile(0.90) / divisor, unit,
+                percentile(0.99) / divisor, unit, percentile(0.999) / divisor, unit,
+                max() / divisor, unit);
+    }
+
+private:
+    static const int SUB_BITS = 7;
+    static const int SUB_HALF = 1 << (SUB_BITS - 1);
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_HALF + SUB_HALF * 2;
+
+    static int bucketOf(uint64_t value)
+    {
+        if (value < (uint64_t)(SUB_HALF * 2)) {
+            return (int)value;
+        }
+#if defined(__GNUC__)
+        int msb = 63 - __builtin_clzll(value);
+#else
+        int msb = 0;
+        while (value >> (msb + 1)) msb++;
+#endif
+        int shift = msb - (SUB_BITS - 1);
+        return shift * SUB_HALF + (int)(value >> shift);
+    }
+
+    static uint64_t bucketUpper(int index)
+    {
+        if (index < SUB_HALF * 2) {
+            return (uint64_t)index;
+        }
+        int shift = index / SUB_HALF - 1;
+        uint64_t mantissa = (uint64_t)(index - shift * SUB_HALF);
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t minValue;
+    uint64_t maxValue;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,88 @@
+#include "LoopProfiler.h"
+#include <csignal>
+#include <cstdlib>
+
+static LoopProfiler* reportedProfiler = nullptr;
+static volatile sig_atomic_t reportRequested = 0;
+
+#ifdef SIGUSR1
+static void requestReport(int)
+{
+    // Only set a flag here; the loop prints outside signal context
+    reportRequested = 1;
+}
+#endif
+
+static void reportAtExit()
+{
+    if (reportedProfiler) {
+        reportedProfiler->report(stderr);
+    }
+}
+
+void LoopProfiler::record(uint64_t ns)
+{
+    uint64_t index = durations.count();
+    durations.record(ns);
+
+    if (ns > worstNanos) {
+        worstNanos = ns;
+        worstIndex = index;
+    }
+
+    if (budgetNanos && ns > budgetNanos) {
+        overrunCount++;
+        if (overrunCount <= OVERRUNS_REPORTED) {
+            fprintf(stderr, "LOOP OVERRUN: iteration %llu took %.1fus (budget %.1fus)%s\n",
+                    (unsigned long long)index, ns / 1000.0, budgetNanos / 1000.0,
+                    overrunCount == OVERRUNS_REPORTED ? " - further overruns only counted" : "");
+        }
+    }
+}
+
+void LoopProfiler::pollReportRequest()
+{
+    if (reportRequested) {
+        reportRequested = 0;
+        report(stderr);
+    }
+}
+
+void LoopProfiler::report(FILE* out) const
+{
+    fprintf(out, "========================================\n");
+    fprintf(out, "LOOP PROFILE\n");
+    durations.print(out, "loop()");
+    fprintf(out, "worst iteration: %llu (%.1fus)\n", (unsigned long long)worstIndex, worstNanos / 1000.0);
+    if (budgetNanos) {
+        double pct = durations.count() ? 100.0 * overrunCount / durations.count() : 0.0;
+        fprintf(out, "budget %.1fus: %llu overruns (%.3f%%)\n", budgetNanos / 1000.0,
+                (unsigned long long)overrunCount, pct);
+    }
+    fprintf(out, "========================================\n");
+    fflush(out);
+}
+
+LoopProfiler* LoopProfiler::fromEnvironment()
+{
+    const char* enabled = getenv("NATIVE_LOOP_PROFILE");
+    const char* budget = getenv("NATIVE_LOOP_BUDGET_US");
+    bool on = (enabled && enabled[0] && enabled[0] != '0') || (budget && budget[0]);
+    if (!on) {
+        return nullptr;
+    }
+    return new LoopProfiler(budget ? strtoull(budget, nullptr, 10) : 0);
+}
+
+void LoopProfiler::installReportHandlers(LoopProfiler* profiler)
+{
+    bool first = reportedProfiler == nullptr;
+    reportedProfiler = profiler;
+    if (!first) {
+        return;
+    }
+    atexit(reportAtExit);
+#ifdef SIGUSR1
+    signal(SIGUSR1, requestReport);
+#endif
+}
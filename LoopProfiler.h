@@ -0,0 +1,88 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include "LatencyHistogram.h"
+
+/**
+ * LoopProfiler: Per-iteration timing of the Arduino loop() on native builds
+ *
+ * Wraps each loop() call, records its host duration in a LatencyHistogram
+ * and flags iterations that exceed a configured budget. The first few
+ * overruns are reported as they happen; the rest are only counted.
+ *
+ * Enabled from ArduinoMain.cpp through environment variables:
+ *   NATIVE_LOOP_PROFILE=1        turn the profiler on
+ *   NATIVE_LOOP_BUDGET_US=<us>   per-iteration budget (implies NATIVE_LOOP_PROFILE)
+ * The summary is printed to stderr at exit and whenever the process receives
+ * SIGUSR1.
+ */
+class LoopProfiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @param budgetMicros Per-iteration budget, 0 for none
+     */
+    explicit LoopProfiler(uint64_t budgetMicros = 0) : budgetNanos(budgetMicros * 1000) {}
+
+    void setBudgetMicros(uint64_t us) { budgetNanos = us * 1000; }
+    uint64_t budgetMicros() const { return budgetNanos / 1000; }
+
+    void beginIteration() { iterationStart = Clock::now(); }
+
+    /**
+     * Close the iteration opened by beginIteration()
+     * @return Iteration duration in nanoseconds
+     */
+    uint64_t endIteration()
+    {
+        uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          Clock::now() - iterationStart).count();
+        record(ns);
+        return ns;
+    }
+
+    /**
+     * Record an iteration duration measured elsewhere
+     */
+    void record(uint64_t ns);
+
+    /**
+     * Print the summary if SIGUSR1 arrived since the last call
+     */
+    void pollReportRequest();
+
+    void report(FILE* out) const;
+
+    const LatencyHistogram& histogram() const { return durations; }
+    uint64_t iterations() const { return durations.count(); }
+    uint64_t overruns() const { return overrunCount; }
+    uint64_t worstIteration() const { return worstIndex; }
+
+    /**
+     * Create the process-wide profiler if the environment asks for one
+     * @return The profiler, or nullptr when profiling is disabled
+     */
+    static LoopProfiler* fromEnvironment();
+
+    /**
+     * Print the summary at exit and on SIGUSR1
+     */
+    static void installReportHandlers(LoopProfiler* profiler);
+
+private:
+    static const uint64_t OVERRUNS_REPORTED = 10;
+
+    LatencyHistogram durations;
+    Clock::time_point iterationStart;
+    uint64_t budgetNanos;
+    uint64_t overrunCount = 0;
+    uint64_t worstIndex = 0;
+    uint64_t worstNanos = 0;
+};
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,120 @@
+#include "LoopScheduler.h"
+#include "Arduino.h"
+#include <cstdlib>
+#include <thread>
+
+static LoopScheduler* reportedScheduler = nullptr;
+
+static void reportAtExit()
+{
+    if (reportedScheduler) {
+        reportedScheduler->report(stderr);
+    }
+}
+
+LoopScheduler::LoopScheduler(double rateHz, double slowdown, bool realtime)
+    : rate(rateHz > 0 ? rateHz : 0), slowdownFactor(slowdown > 0 ? slowdown : 1.0), realtime(realtime)
+{
+    periodNanos = rate > 0 ? (uint64_t)(1e9 / rate + 0.5) : 0;
+}
+
+void LoopScheduler::beginIteration()
+{
+    if (!started) {
+        setVirtualTime(true);
+        virtualNanos = micros() * 1000;
+        nextSlotNanos = virtualNanos;
+        lastStartNanos = virtualNanos;
+        wallOrigin = Clock::now();
+        originNanos = virtualNanos;
+        started = true;
+    }
+
+    uint64_t start = periodNanos && nextSlotNanos > virtualNanos ? nextSlotNanos : virtualNanos;
+    slotNanos = periodNanos ? nextSlotNanos : start;
+
+    if (realtime) {
+        std::this_thread::sleep_until(wallOrigin + std::chrono::nanoseconds(start - originNanos));
+    }
+
+    if (iterationCount > 0) {
+        intervalHist.record(start - lastStartNanos);
+    }
+    lastStartNanos = start;
+    iterationStartNanos = start;
+
+    setMicros(start / 1000);
+    clockAtStartMicros = micros();
+    hostStart = Clock::now();
+}
+
+void LoopScheduler::endIteration()
+{
+    uint64_t hostNanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             Clock::now() - hostStart).count();
+
+    // Virtual time the firmware spent in delay() during the iteration
+    uint64_t nowMicros = micros();
+    uint64_t delayedNanos = nowMicros > clockAtStartMicros ? (nowMicros - clockAtStartMicros) * 1000 : 0;
+
+    uint64_t cost = (uint64_t)(hostNanos * slowdownFactor) + delayedNanos;
+    costHist.record(cost);
+    iterationCount++;
+
+    virtualNanos = iterationStartNanos + cost;
+    setMicros(virtualNanos / 1000);
+
+    if (periodNanos) {
+        uint64_t deadline = slotNanos + periodNanos;
+        if (virtualNanos > deadline) {
+            missed++;
+        }
+        nextSlotNanos = deadline;
+        if (virtualNanos > nextSlotNanos) {
+            uint64_t late = (virtualNanos - nextSlotNanos + periodNanos - 1) / periodNanos;
+            nextSlotNanos += late * periodNanos;
+            skipped += late;
+        }
+    }
+}
+
+void LoopScheduler::report(FILE* out) const
+{
+    fprintf(out, "========================================\n");
+    fprintf(out, "LOOP SCHEDULE (rate %.1fHz, slowdown %.2fx%s)\n", rate, slowdownFactor,
+            realtime ? ", realtime" : "");
+    costHist.print(out, "target cost");
+    intervalHist.print(out, "interval");
+    if (periodNanos) {
+        double pct = iterationCount ? 100.0 * missed / iterationCount : 0.0;
+        fprintf(out, "deadlines: %llu missed of %llu (%.3f%%), %llu slots skipped\n",
+                (unsigned long long)missed, (unsigned long long)iterationCount, pct,
+                (unsigned long long)skipped);
+    }
+    fprintf(out, "virtual time: %.3fs\n", virtualNanos / 1e9);
+    fprintf(out, "========================================\n");
+    fflush(out);
+}
+
+LoopScheduler* LoopScheduler::fromEnvironment()
+{
+    const char* rateEnv = getenv("NATIVE_LOOP_RATE_HZ");
+    const char* slowdownEnv = getenv("NATIVE_CPU_SLOWDOWN");
+    const char* realtimeEnv = getenv("NATIVE_REALTIME");
+    if (!(rateEnv && rateEnv[0]) && !(slowdownEnv && slowdownEnv[0])) {
+        return nullptr;
+    }
+    double rateHz = rateEnv ? atof(rateEnv) : 0.0;
+    double slowdown = slowdownEnv && slowdownEnv[0] ? atof(slowdownEnv) : 1.0;
+    bool paced = realtimeEnv && realtimeEnv[0] && realtimeEnv[0] != '0';
+    return new LoopScheduler(rateHz, slowdown, paced);
+}
+
+void LoopScheduler::installReportHandler(LoopScheduler* scheduler)
+{
+    bool first = reportedScheduler == nullptr;
+    reportedScheduler = scheduler;
+    if (first) {
+        atexit(reportAtExit);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef LOOP_SCHEDULER_H
+#define LOOP_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include "LatencyHistogram.h"
+
+/**
+ * LoopScheduler: Fixed-rate loop() scheduling in virtual time
+ *
+ * Runs the firmware on the fake clock (setVirtualTime) and charges every
+ * iteration the host time it took multiplied by a slowdown factor, i.e. how
+ * much slower the target MCU is than the host. Iterations start on a fixed
+ * grid of 1/rate; an iteration that is still running when its slot ends
+ * misses its deadline and the next one starts at the first free slot.
+ * Time the firmware spends in delay() is added as-is.
+ *
+ * With rate 0 the loop free-runs: each iteration starts when the previous
+ * one ends on the target, so timing still reflects the emulated CPU speed.
+ *
+ * Enabled from ArduinoMain.cpp through environment variables:
+ *   NATIVE_LOOP_RATE_HZ=<hz>     target loop rate
+ *   NATIVE_CPU_SLOWDOWN=<x>      host-to-target slowdown factor (default 1)
+ *   NATIVE_REALTIME=1            also pace the run against the wall clock
+ */
+class LoopScheduler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @param rateHz Target loop rate, 0 to free-run
+     * @param slowdown Multiplier applied to measured host loop time
+     * @param realtime Sleep so that virtual time does not run ahead of wall time
+     */
+    LoopScheduler(double rateHz, double slowdown = 1.0, bool realtime = false);
+
+    /**
+     * Move the virtual clock to the start of the next slot
+     */
+    void beginIteration();
+
+    /**
+     * Charge the iteration to the virtual clock and check its deadline
+     */
+    void endIteration();
+
+    void report(FILE* out) const;
+
+    double rateHz() const { return rate; }
+    double slowdown() const { return slowdownFactor; }
+    uint64_t iterations() const { return iterationCount; }
+    uint64_t missedDeadlines() const { return missed; }
+    uint64_t skippedSlots() const { return skipped; }
+
+    // Virtual start-to-start interval and charged cost per iteration, in ns
+    const LatencyHistogram& intervals() const { return intervalHist; }
+    const LatencyHistogram& costs() const { return costHist; }
+
+    /**
+     * Create the process-wide scheduler if the environment asks for one
+     * @return The scheduler, or nullptr when loop() should free-run on the host clock
+     */
+    static LoopScheduler* fromEnvironment();
+
+    /**
+     * Print the summary at exit
+     */
+    static void installReportHandler(LoopScheduler* scheduler);
+
+private:
+    double rate;
+    double slowdownFactor;
+    bool realtime;
+    uint64_t periodNanos;
+
+    // Virtual time is tracked in ns so fractional slowdowns do not drift
+    uint64_t virtualNanos = 0;
+    uint64_t nextSlotNanos = 0;
+    uint64_t slotNanos = 0;
+    uint64_t originNanos = 0;
+    uint64_t iterationStartNanos = 0;
+    uint64_t lastStartNanos = 0;
+    uint64_t clockAtStartMicros = 0;
+    Clock::time_point hostStart;
+    Clock::time_point wallOrigin;
+    bool started = false;
+
+    uint64_t iterationCount = 0;
+    uint64_t missed = 0;
+    uint64_t skipped = 0;
+    LatencyHistogram intervalHist;
+    LatencyHistogram costHist;
+};
+
+#endif // LOOP_SCHEDULER_H
@@ -1,129 +1,464 @@
 #include "MockStorage.h"
 #include "RecordData/Storage/StorageFactory.h"
+#include "RamStorage.h"
+#include "MockWorld.h"
+#include "WriteBehindFile.h"
+#include "CompressedFile.h"
+#ifdef __linux__
+#include "UringStorage.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // MockFile implementation
 MockFile::MockFile(const char* filename, const char* mode) {
+    if (strchr(mode, 'm')) {
+        if (openMapped(filename)) _stats = IoStats::forPath(filename);
+        return;
+    }
+
     _file = fopen(filename, mode);
+    if (!_file) return;
+    _stats = IoStats::forPath(filename);
+
+    _append = strchr(mode, 'a') != nullptr;
+    _readable = strchr(mode, 'r') != nullptr || strchr(mode, '+') != nullptr;
+    _writable = _append || strchr(mode, 'w') != nullptr || strchr(mode, '+') != nullptr;
+
+    // Measure the file once; afterwards length and position are tracked locally
+    fseek(_file, 0, SEEK_END);
+    long end = ftell(_file);
+    _size = end > 0 ? (uint32_t)end : 0;
+    if (_append) {
+        _pos = _size;
+    } else {
+        fseek(_file, 0, SEEK_SET);
+        _pos = 0;
+    }
 }
 
 MockFile::~MockFile() {
     if (_file) {
         fclose(_file);
     }
+    unmap();
+}
+
+bool MockFile::openMapped(const char* filename) {
+#ifdef _WIN32
+    // No mmap here: load the file once so the view API still works
+    FILE* f = fopen(filename, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long end = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* buffer = nullptr;
+    if (end > 0) {
+        buffer = (uint8_t*)malloc((size_t)end);
+        if (!buffer || fread(buffer, 1, (size_t)end, f) != (size_t)end) {
+            free(buffer);
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    _map = buffer;
+    _mapSize = end > 0 ? (size_t)end : 0;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size > 0) {
+        void* addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        // Log scans run front to back: read ahead aggressively, drop pages behind
+        madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+        _map = (const uint8_t*)addr;
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    _mapSize = (size_t)st.st_size;
+#endif
+    _mapped = true;
+    _readable = true;
+    _mapPos = 0;
+    return true;
+}
+
+void MockFile::unmap() {
+    if (!_mapped) return;
+#ifdef _WIN32
+    free((void*)_map);
+#else
+    if (_map) munmap((void*)_map, _mapSize);
+#endif
+    _map = nullptr;
+    _mapSize = 0;
+    _mapPos = 0;
+    _mapped = false;
 }
 
 size_t MockFile::write(uint8_t b) {
-    if (!_file) return 0;
-    return fwrite(&b, 1, 1, _file);
+    return write(&b, 1);
 }
 
 size_t MockFile::write(const uint8_t *buffer, size_t size) {
     if (!_file) return 0;
-    return fwrite(buffer, 1, size, _file);
+    _stats->recordWrite(size);
+    if (!_framer) return writeRaw(buffer, size);
+    uint8_t header[FrameWriter::HEADER_SIZE];
+    _framer->frame(buffer, size, micros(), header);
+    if (writeRaw(header, sizeof(header)) != sizeof(header)) return 0;
+    return writeRaw(buffer, size);
+}
+
+size_t MockFile::writeRaw(const uint8_t *buffer, size_t size) {
+    size_t written = fwrite(buffer, 1, size, _file);
+    // Append mode always writes at the end, wherever the last seek went
+    if (_append) _pos = _size;
+    _pos += (uint32_t)written;
+    if (_pos > _size) _size = _pos;
+    if (_device) _device->chargeWrite(written);
+    return written;
+}
+
+bool MockFile::setFraming(uint64_t indexInterval) {
+    if (!_file || !_writable) return false;
+    std::unique_ptr<FrameWriter> framer(new FrameWriter(indexInterval));
+    if (!framer->open(_stats->path(), _append ? _size : _pos)) return false;
+    _framer = std::move(framer);
+    return true;
 }
 
 bool MockFile::flush() {
+    if (_mapped) return true;
     if (!_file) return false;
-    return fflush(_file) == 0;
+    auto start = std::chrono::steady_clock::now();
+    bool flushed = fflush(_file) == 0;
+    // Index entries go out after the data they point at
+    if (_framer) _framer->flush();
+    if (_device && _writable) _device->chargeFlush();
+    _stats->recordFlush((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    return flushed;
 }
 
 int MockFile::read() {
+    if (_mapped) {
+        const uint8_t* data;
+        return readView(data, 1) ? data[0] : -1;
+    }
     if (!_file) return -1;
     int c = fgetc(_file);
+    if (c != EOF) _pos++;
+    if (_device) _device->chargeRead(c != EOF ? 1 : 0);
+    _stats->recordRead(c != EOF ? 1 : 0);
     return c;
 }
 
 int MockFile::readBytes(uint8_t *buffer, size_t length) {
+    if (_mapped) {
+        const uint8_t* data;
+        size_t n = readView(data, length);
+        if (n) memcpy(buffer, data, n);
+        return (int)n;
+    }
     if (!_file) return 0;
-    return fread(buffer, 1, length, _file);
+    size_t n = fread(buffer, 1, length, _file);
+    _pos += (uint32_t)n;
+    if (_device) _device->chargeRead(n);
+    _stats->recordRead(n);
+    return n;
 }
 
 int MockFile::available() {
-    if (!_file) return 0;
-    long current = ftell(_file);
-    fseek(_file, 0, SEEK_END);
-    long end = ftell(_file);
-    fseek(_file, current, SEEK_SET);
-    return end - current;
+    if (_mapped) {
+        size_t left = _mapSize > _mapPos ? _mapSize - _mapPos : 0;
+        return left > (size_t)INT_MAX ? INT_MAX : (int)left;
+    }
+    if (!isOpen()) return 0;
+    if (_pos >= _size) refreshSize();
+    return _size > _pos ? (int)(_size - _pos) : 0;
 }
 
 bool MockFile::seek(uint32_t pos) {
+    if (_mapped) {
+        _mapPos = pos;
+        return true;
+    }
     if (!_file) return false;
-    return fseek(_file, pos, SEEK_SET) == 0;
+    // Skip the stdio round trip when already there, unless EOF must be cleared
+    if (pos == _pos && !feof(_file)) return true;
+    if (fseek(_file, pos, SEEK_SET) != 0) return false;
+    _pos = pos;
+    return true;
 }
 
 uint32_t MockFile::position() {
-    if (!_file) return 0;
-    return ftell(_file);
+    if (_mapped) return _mapPos > UINT32_MAX ? UINT32_MAX : (uint32_t)_mapPos;
+    if (!isOpen()) return 0;
+    return _pos;
 }
 
 uint32_t MockFile::size() {
-    if (!_file) return 0;
-    long current = ftell(_file);
+    if (_mapped) return _mapSize > UINT32_MAX ? UINT32_MAX : (uint32_t)_mapSize;
+    if (!isOpen()) return 0;
+    if (_pos >= _size) refreshSize();
+    return _size;
+}
+
+void MockFile::refreshSize() {
+    // Another handle may have appended since we measured; only readers care,
+    // and only once they have caught up with the length they know about.
+    // A mapping is fixed at open time.
+    if (!_readable || _mapped) return;
     fseek(_file, 0, SEEK_END);
-    uint32_t size = ftell(_file);
-    fseek(_file, current, SEEK_SET);
-    return size;
+    long end = ftell(_file);
+    fseek(_file, _pos, SEEK_SET);
+    if (end > 0 && (uint32_t)end > _size) _size = (uint32_t)end;
 }
 
 bool MockFile::close() {
+    if (_mapped) {
+        unmap();
+        return true;
+    }
     if (!_file) return false;
     bool closed = fclose(_file) == 0;
+    _framer.reset();
+    // Closing syncs metadata like a flush
+    if (_device && _writable) _device->chargeFlush();
     _file = nullptr;
     return closed;
 }
 
 bool MockFile::isOpen() const {
-    return _file != nullptr;
+    return _file != nullptr || _mapped;
+}
+
+size_t MockFile::readView(const uint8_t*& data, size_t length) {
+    data = nullptr;
+    if (!_mapped || _mapPos >= _mapSize) return 0;
+    size_t left = _mapSize - _mapPos;
+    if (length > left) length = left;
+    data = _map + _mapPos;
+    _mapPos += length;
+    if (_device) _device->chargeRead(length);
+    _stats->recordRead(length);
+    return length;
 }
 
 
 // MockStorage implementation
-bool MockStorage::begin() { return true; }
+namespace stdfs = std::filesystem;
+
+MockStorage::MockStorage(const std::string& root) {
+    setRoot(root);
+}
+
+void MockStorage::setRoot(const std::string& root) {
+    rootPath = root;
+    if (!rootPath.empty()) {
+        std::error_code ec;
+        stdfs::create_directories(rootPath, ec);
+    }
+}
+
+std::string MockStorage::root() const {
+    if (!rootPath.empty()) return rootPath;
+    if (MockWorld* world = MockWorld::current()) {
+        if (!world->storageRoot().empty()) return world->storageRoot();
+    }
+    const char* env = getenv("NATIVE_STORAGE_ROOT");
+    return env ? env : "";
+}
+
+std::string MockStorage::resolve(const char *path) const {
+    std::string base = root();
+    if (base.empty()) return path;
+
+    stdfs::path relative = stdfs::path(path).relative_path().lexically_normal();
+    if (!relative.empty() && *relative.begin() == "..") {
+        fprintf(stderr, "MockStorage: '%s' is outside the storage root\n", path);
+        return std::string();
+    }
+    return (stdfs::path(base) / relative).string();
+}
+
+std::string MockStorage::createSandbox(const char *prefix) {
+    std::error_code ec;
+    stdfs::path tmp = stdfs::temp_directory_path(ec);
+    if (ec) return std::string();
+#ifdef _WIN32
+    // No mkdtemp: try numbered names until one is free
+    static int counter = 0;
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        stdfs::path dir = tmp / (std::string(prefix) + "-" + std::to_string(GetCurrentProcessId()) +
+                                 "-" + std::to_string(counter++));
+        if (stdfs::create_directory(dir, ec)) return dir.string();
+    }
+    return std::string();
+#else
+    std::string pattern = (tmp / (std::string(prefix) + "-XXXXXX")).string();
+    if (!mkdtemp(&pattern[0])) return std::string();
+    return pattern;
+#endif
+}
+
+bool MockStorage::begin() {
+    std::string base = root();
+    if (base.empty()) return true;
+    std::error_code ec;
+    stdfs::create_directories(base, ec);
+    return !ec;
+}
+
 bool MockStorage::end() { return true; }
 bool MockStorage::ok() const { return true; }
 
 astra::IFile* MockStorage::openRead(const char *filename) {
-    return new MockFile(filename, "rb");
+    std::string path = resolve(filename);
+    if (CompressedFile::sniff(path.c_str())) {
+        return new CompressedFile(path.c_str(), "rb");
+    }
+    MockFile* file = new MockFile(path.c_str(), mappedReads ? "rbm" : "rb");
+    file->setDevice(device);
+    return file;
 }
 
 astra::IFile* MockStorage::openWrite(const char *filename, bool append) {
-    return new MockFile(filename, append ? "ab" : "wb");
+    std::string path = resolve(filename);
+    // Appending plain bytes would corrupt a compressed file
+    if (compressionBlockBytes || (append && CompressedFile::sniff(path.c_str()))) {
+        return new CompressedFile(path.c_str(), append ? "ab" : "wb", compressionBlockBytes);
+    }
+    if (writeBehindBytes) {
+        return new WriteBehindFile(path.c_str(), append, writeBehindBytes);
+    }
+    MockFile* file = new MockFile(path.c_str(), append ? "ab" : "wb");
+    file->setDevice(device);
+    if (framingInterval) file->setFraming(framingInterval);
+    return file;
 }
 
 bool MockStorage::exists(const char *filename) {
-    if (FILE *file = fopen(filename, "r")) {
-        fclose(file);
-        return true;
-    }
-    return false;
+    std::string path = resolve(filename);
+    std::error_code ec;
+    return !path.empty() && stdfs::exists(path, ec);
 }
 
 bool MockStorage::remove(const char *filename) {
-    return ::remove(filename) == 0;
+    std::string path = resolve(filename);
+    std::error_code ec;
+    if (path.empty() || stdfs::is_directory(path, ec)) return false;
+    return stdfs::remove(path, ec);
 }
 
 bool MockStorage::mkdir(const char *path) {
-    // Not properly implemented for cross-platform, but this might work on some systems
-    // For Windows, might need to use _mkdir or CreateDirectory
-    // For now, just return true to not block tests
-    std::cout << "Warning: MockStorage::mkdir is not implemented. Path: " << path << std::endl;
-    return true;
+    std::string target = resolve(path);
+    if (target.empty()) return false;
+    std::error_code ec;
+    stdfs::create_directories(target, ec);
+    return !ec && stdfs::is_directory(target, ec);
 }
 
 bool MockStorage::rmdir(const char *path) {
-    std::cout << "Warning: MockStorage::rmdir is not implemented. Path: " << path << std::endl;
-    return true;
+    std::string target = resolve(path);
+    std::error_code ec;
+    if (target.empty() || !stdfs::is_directory(target, ec)) return false;
+    // Fails on a non-empty directory, like the real call
+    return stdfs::remove(target, ec);
+}
+
+std::vector<std::string> MockStorage::list(const char *path) {
+    std::vector<std::string> names;
+    std::string target = resolve(path);
+    if (target.empty()) return names;
+    std::error_code ec;
+    for (stdfs::directory_iterator it(target, ec), end; !ec && it != end; it.increment(ec)) {
+        names.push_back(it->path().filename().string());
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+bool MockStorage::removeAll(const char *path) {
+    std::string target = resolve(path);
+    if (target.empty()) return false;
+    std::error_code ec;
+    return stdfs::remove_all(target, ec) > 0 && !ec;
+}
+
+bool MockStorage::cleanup() {
+    std::string base = root();
+    if (base.empty()) return false;
+    std::error_code ec;
+    stdfs::remove_all(base, ec);
+    return !ec;
+}
+
+// Backend selection
+static bool backendChosen = false;
+static NativeStorageBackend selectedBackend = NativeStorageBackend::Disk;
+
+void setNativeStorageBackend(NativeStorageBackend backend) {
+    selectedBackend = backend;
+    backendChosen = true;
+}
+
+NativeStorageBackend nativeStorageBackend() {
+    if (!backendChosen) {
+        const char* env = getenv("NATIVE_STORAGE");
+        if (env && strcmp(env, "ram") == 0) {
+            selectedBackend = NativeStorageBackend::Ram;
+        } else if (env && strcmp(env, "uring") == 0) {
+            selectedBackend = NativeStorageBackend::Uring;
+        }
+        backendChosen = true;
+    }
+    return selectedBackend;
 }
 
 // Native StorageFactory implementation
 namespace astra {
     IStorage *StorageFactory::create(StorageBackend type) {
-        // In native test environment, always return a MockStorage instance
-        // regardless of the type requested.
+        // In native test environment, ignore the type requested and return
+        // the selected mock backend.
+        if (nativeStorageBackend() == NativeStorageBackend::Ram) {
+            std::cout << "Creating RamStorage" << std::endl;
+            return new RamStorage(RamFs::global());
+        }
+#ifdef __linux__
+        if (nativeStorageBackend() == NativeStorageBackend::Uring) {
+            std::cout << "Creating UringStorage" << std::endl;
+            return new UringStorage();
+        }
+#endif
         std::cout << "Creating MockStorage" << std::endl;
-        return new MockStorage();
+        MockStorage* storage = new MockStorage();
+        storage->setDeviceModel(StorageDeviceModel::fromEnvironment());
+        return storage;
     }
 }
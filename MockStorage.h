@@ -2,14 +2,32 @@
 #define MOCK_STORAGE_H
 
 #include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
 #include "RecordData/Storage/IStorage.h"
 #include "RecordData/Storage/IFile.h"
+#include "StorageDeviceModel.h"
+#include "IoStats.h"
+#include "FramedLog.h"
 
+/**
+ * MockFile: IFile backed by a host file
+ *
+ * A mode containing 'm' (e.g. "rbm") opens the file read-only and memory-maps
+ * it instead of going through stdio. Reads are then memcpy from the mapping,
+ * and readView() hands out pointers into it without copying, which is how
+ * large logs should be scanned. The mapping covers the file as it was when
+ * opened; later appends by other handles are not seen.
+ */
 class MockFile : public astra::IFile {
 public:
     MockFile(const char* filename, const char* mode);
     ~MockFile();
 
+    MockFile(const MockFile&) = delete;
+    MockFile& operator=(const MockFile&) = delete;
+
     size_t write(uint8_t b) override;
     size_t write(const uint8_t *buffer, size_t size) override;
     bool flush() override;
@@ -25,13 +43,92 @@ public:
 
     bool isOpen() const override;
 
+    /**
+     * Zero-copy read for mapped files: point data at the next bytes and advance
+     * @param data Set to the current position inside the mapping
+     * @param length Maximum number of bytes wanted
+     * @return Number of bytes available at data (0 at EOF or if not mapped)
+     */
+    size_t readView(const uint8_t*& data, size_t length);
+
+    /**
+     * Start of the whole mapping, or nullptr if the file is not mapped
+     */
+    const uint8_t* mappedData() const { return _mapped ? _map : nullptr; }
+
+    /**
+     * Length of the whole mapping, or 0 if the file is not mapped. Unlike
+     * size(), this is not clamped to 32 bits.
+     */
+    size_t mappedSize() const { return _mapped ? _mapSize : 0; }
+
+    bool isMapped() const { return _mapped; }
+
+    /**
+     * Charge this file's I/O to an emulated device (see StorageDeviceModel.h)
+     */
+    void setDevice(std::shared_ptr<StorageDeviceModel> device) { _device = std::move(device); }
+
+    /**
+     * I/O counters of this file's path (shared with other handles on it),
+     * nullptr if the file did not open
+     */
+    IoStats* stats() const { return _stats.get(); }
+
+    /**
+     * Frame each write() call from now on as one record with its micros()
+     * timestamp and a CRC, and index it in "<file>.tidx" (see FramedLog.h).
+     * Meant for files written sequentially; a single-byte write() becomes a
+     * record of its own.
+     * @param indexInterval Bytes between time index entries
+     */
+    bool setFraming(uint64_t indexInterval = FrameWriter::DEFAULT_INDEX_INTERVAL);
+
+    bool isFramed() const { return _framer != nullptr; }
+
 private:
-    FILE* _file;
+    size_t writeRaw(const uint8_t *buffer, size_t size);
+    void refreshSize();
+    bool openMapped(const char* filename);
+    void unmap();
+
+    FILE* _file = nullptr;
+    // Logical position and length, kept in sync so size()/available()/position()
+    // are plain arithmetic instead of ftell/fseek round trips
+    uint32_t _pos = 0;
+    uint32_t _size = 0;
+    bool _append = false;
+    bool _readable = false;
+    bool _writable = false;
+
+    std::shared_ptr<StorageDeviceModel> _device;
+    std::shared_ptr<IoStats> _stats;
+    std::unique_ptr<FrameWriter> _framer;
+
+    // Mapped read mode. The mapping keeps its own full-width length and
+    // position; _pos/_size are unused and the IFile accessors clamp to 32 bits.
+    bool _mapped = false;
+    const uint8_t* _map = nullptr;  // nullptr for an empty mapped file
+    size_t _mapSize = 0;
+    size_t _mapPos = 0;
 };
 
+/**
+ * MockStorage: IStorage on the host filesystem
+ *
+ * Paths resolve against a sandbox root so parallel tests do not share files.
+ * The root is, in order of preference: the one set on this storage, the
+ * storage root of the MockWorld bound to the calling thread, the
+ * NATIVE_STORAGE_ROOT environment variable. Without any of them paths are
+ * used as given, relative to the working directory. Absolute paths are
+ * taken relative to the root, and paths leaving it through ".." are refused.
+ */
 class MockStorage : public astra::IStorage {
 public:
-    bool begin() override;
+    MockStorage() = default;
+    explicit MockStorage(const std::string& root);
+
+    bool begin() override;  // Creates the root directory
     bool end() override;
     bool ok() const override;
 
@@ -40,8 +137,97 @@ public:
 
     bool exists(const char *filename) override;
     bool remove(const char *filename) override;
-    bool mkdir(const char *path) override;
-    bool rmdir(const char *path) override;
+    bool mkdir(const char *path) override;   // Creates missing parents
+    bool rmdir(const char *path) override;   // Directory must be empty
+
+    /**
+     * Names of the entries directly inside a directory, sorted
+     */
+    std::vector<std::string> list(const char *path);
+
+    /**
+     * Remove a file or a directory with everything below it
+     */
+    bool removeAll(const char *path);
+
+    /**
+     * Delete the root directory and its contents
+     * @return false if there is no root (the working directory is never removed)
+     */
+    bool cleanup();
+
+    void setRoot(const std::string& root);
+
+    /**
+     * Root in effect for the calling thread, empty for the working directory
+     */
+    std::string root() const;
+
+    /**
+     * Host path for a storage path, empty if it would escape the root
+     */
+    std::string resolve(const char *path) const;
+
+    /**
+     * Create a fresh, uniquely named directory under the system temp dir
+     * @return Its path, or an empty string on failure
+     */
+    static std::string createSandbox(const char *prefix = "native-storage");
+
+    /**
+     * Make openRead() memory-map files (MockFile mode "rbm")
+     */
+    void setMappedReads(bool enabled) { mappedReads = enabled; }
+
+    /**
+     * Make openWrite() return a WriteBehindFile with two buffers of this size,
+     * 0 for plain MockFile writes
+     */
+    void setWriteBehind(size_t bufferBytes) { writeBehindBytes = bufferBytes; }
+
+    /**
+     * Make openWrite() return a CompressedFile with blocks of this size, 0 to
+     * write plain files. openRead() and appends detect compressed files by
+     * their header either way.
+     */
+    void setCompression(size_t blockBytes) { compressionBlockBytes = blockBytes; }
+
+    /**
+     * Make openWrite() frame records and keep a time index (MockFile::setFraming),
+     * 0 to write plain files. Applies to plain MockFile writes, not to
+     * write-behind or compressed files.
+     */
+    void setFraming(uint64_t indexIntervalBytes) { framingInterval = indexIntervalBytes; }
+
+    /**
+     * Emulate device timing on files opened from now on, nullptr for host speed
+     */
+    void setDeviceModel(std::shared_ptr<StorageDeviceModel> model) { device = std::move(model); }
+    std::shared_ptr<StorageDeviceModel> deviceModel() const { return device; }
+
+private:
+    std::string rootPath;
+    bool mappedReads = false;
+    size_t writeBehindBytes = 0;
+    size_t compressionBlockBytes = 0;
+    uint64_t framingInterval = 0;
+    std::shared_ptr<StorageDeviceModel> device;
 };
 
+/**
+ * Backend handed out by StorageFactory::create in native builds
+ *
+ * Defaults to Disk (MockStorage). Setting the NATIVE_STORAGE environment
+ * variable to "ram" selects RamStorage sharing RamFs::global() instead,
+ * "uring" selects UringStorage.
+ */
+enum class NativeStorageBackend {
+    Disk,
+    Ram,
+    Uring,  // UringStorage, Linux only (Disk elsewhere)
+};
+
+void setNativeStorageBackend(NativeStorageBackend backend);
+NativeStorageBackend nativeStorageBackend();
+
 #endif // MOCK_STORAGE_H
@@ -0,0 +1,143 @@
+#include "MockWorld.h"
+
+static thread_local MockWorld* boundWorld = nullptr;
+
+// SerialChannel implementation
+size_t SerialChannel::write(const uint8_t* data, size_t len)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    staged.insert(staged.end(), data, data + len);
+    if (autoCommit) {
+        ready.insert(ready.end(), staged.begin(), staged.end());
+        staged.clear();
+    }
+    return len;
+}
+
+size_t SerialChannel::read(uint8_t* buffer, size_t maxLen)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t count = ready.size() - readCursor;
+    if (count > maxLen) {
+        count = maxLen;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    memcpy(buffer, ready.data() + readCursor, count);
+    readCursor += count;
+    if (readCursor == ready.size()) {
+        ready.clear();
+        readCursor = 0;
+    }
+    return count;
+}
+
+void SerialChannel::commit()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (staged.empty()) {
+        return;
+    }
+    ready.insert(ready.end(), staged.begin(), staged.end());
+    staged.clear();
+}
+
+size_t SerialChannel::pending() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return ready.size() - readCursor;
+}
+
+// MockWorld implementation
+MockWorld::MockWorld(const char* name) : worldName(name ? name : "world") {}
+
+MockWorld::~MockWorld()
+{
+    if (boundWorld == this) {
+        boundWorld = nullptr;
+    }
+    // Drop links other worlds created towards this one
+    while (!linkedFrom.empty()) {
+        linkedFrom.back()->dropLinksTo(this);
+    }
+    // Drop links this world created
+    while (!links.empty()) {
+        dropLinksTo(links.back().peer);
+    }
+}
+
+void MockWorld::dropLinksTo(MockWorld* peer)
+{
+    for (size_t i = 0; i < links.size();) {
+        Link& link = links[i];
+        if (link.peer != peer) {
+            ++i;
+            continue;
+        }
+        link.local->attachChannels(nullptr, nullptr);
+        link.remote->attachChannels(nullptr, nullptr);
+        delete link.outbound;
+        delete link.inbound;
+        links.erase(links.begin() + i);
+    }
+    std::vector<MockWorld*>& back = peer->linkedFrom;
+    for (size_t i = 0; i < back.size();) {
+        if (back[i] == this) {
+            back.erase(back.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+int MockWorld::analogRead(int pin) const
+{
+    auto it = analogValues.find(pin);
+    if (it != analogValues.end()) {
+        return it->second;
+    }
+    // Same mid-range default as the process-wide mock
+    return 512;
+}
+
+SerialClass& MockWorld::serial(int port)
+{
+    if (port < 0 || port >= SERIAL_PORTS) {
+        port = 0;
+    }
+    return ports[port];
+}
+
+void MockWorld::linkSerial(int port, MockWorld& other, int otherPort)
+{
+    Link link;
+    link.outbound = new SerialChannel();
+    link.inbound = new SerialChannel();
+    link.local = &serial(port);
+    link.remote = &other.serial(otherPort);
+    link.peer = &other;
+    links.push_back(link);
+    other.linkedFrom.push_back(this);
+
+    link.local->attachChannels(link.inbound, link.outbound);
+    link.remote->attachChannels(link.outbound, link.inbound);
+}
+
+void MockWorld::commitChannels()
+{
+    for (Link& link : links) {
+        link.outbound->commit();
+        link.inbound->commit();
+    }
+}
+
+MockWorld* MockWorld::current()
+{
+    return boundWorld;
+}
+
+void MockWorld::bind(MockWorld* world)
+{
+    boundWorld = world;
+}
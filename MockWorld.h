@@ -0,0 +1,162 @@
+#ifndef MOCK_WORLD_H
+#define MOCK_WORLD_H
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+/**
+ * SerialChannel: In-memory, one-directional byte pipe between two mock serial ports
+ *
+ * Bytes written during a scheduler tick are staged and only become readable
+ * after commit(), so cross-instance traffic is deterministic no matter how
+ * instances are spread over worker threads. Outside a FirmwareHost, call
+ * commit() yourself (or construct with autoCommit = true).
+ */
+class SerialChannel
+{
+public:
+    explicit SerialChannel(bool autoCommit = false) : autoCommit(autoCommit) {}
+
+    /**
+     * Stage bytes for the receiving side
+     * @return Number of bytes accepted
+     */
+    size_t write(const uint8_t* data, size_t len);
+
+    /**
+     * Read committed bytes (non-blocking)
+     * @return Number of bytes copied into buffer, 0 if none available
+     */
+    size_t read(uint8_t* buffer, size_t maxLen);
+
+    /**
+     * Make all staged bytes visible to the reader
+     */
+    void commit();
+
+    size_t pending() const;
+
+private:
+    mutable std::mutex lock;
+    std::vector<uint8_t> staged;
+    std::vector<uint8_t> ready;
+    size_t readCursor = 0;
+    bool autoCommit;
+};
+
+/**
+ * MockWorld: The per-firmware-instance state behind the Arduino mocks
+ *
+ * Holds a virtual clock, mocked analog inputs and four serial ports. While a
+ * world is bound to the calling thread (see MockWorldScope), millis(), micros(),
+ * delay(), analogRead(), digitalWrite() and the global Serial..Serial3 objects
+ * all operate on that world instead of the process-wide defaults.
+ *
+ * A world's clock is always virtual: delay() advances it instead of sleeping,
+ * so an instance never blocks the worker thread it is scheduled on.
+ */
+class MockWorld
+{
+public:
+    static const int SERIAL_PORTS = 4;
+
+    explicit MockWorld(const char* name = "world");
+    ~MockWorld();
+
+    MockWorld(const MockWorld&) = delete;
+    MockWorld& operator=(const MockWorld&) = delete;
+
+    const char* name() const { return worldName.c_str(); }
+
+    // Virtual clock
+    uint64_t micros() const { return clockMicros; }
+    uint64_t millis() const { return clockMicros / 1000; }
+    void setMicros(uint64_t us) { clockMicros = us; }
+    void advanceMicros(uint64_t us) { clockMicros += us; }
+
+    // Mocked analog inputs
+    int analogRead(int pin) const;
+    void setAnalogRead(int pin, int value) { analogValues[pin] = value; }
+    void clearAnalogReads() { analogValues.clear(); }
+
+    // State behind random()/randomSeed() for this world
+    uint64_t randomState = 0x853c49e6748fea9bULL;
+
+    /**
+     * Directory MockStorage resolves paths against while this world is bound,
+     * unless the storage has a root of its own (see MockStorage::setRoot)
+     */
+    void setStorageRoot(const std::string& root) { storageRootPath = root; }
+    const std::string& storageRoot() const { return storageRootPath; }
+
+    /**
+     * Serial port owned by this world
+     * @param port 0 for Serial, 1..3 for Serial1..Serial3
+     */
+    SerialClass& serial(int port);
+
+    /**
+     * Connect a serial port of this world to a serial port of another world
+     * with a pair of in-memory channels (full duplex). Channels are owned by
+     * the world that created the link; destroying either world detaches both
+     * ports.
+     */
+    void linkSerial(int port, MockWorld& other, int otherPort);
+
+    /**
+     * Commit staged bytes on every link created by this world
+     */
+    void commitChannels();
+
+    /**
+     * World bound to the calling thread, or nullptr for the process-wide mocks
+     */
+    static MockWorld* current();
+
+private:
+    friend class MockWorldScope;
+    static void bind(MockWorld* world);
+
+    std::string worldName;
+    std::string storageRootPath;
+    uint64_t clockMicros = 0;
+    std::map<int, int> analogValues;
+    SerialClass ports[SERIAL_PORTS];
+
+    struct Link {
+        SerialChannel* outbound;
+        SerialChannel* inbound;
+        Stream* local;
+        Stream* remote;
+        MockWorld* peer;
+    };
+    std::vector<Link> links;
+    std::vector<MockWorld*> linkedFrom;  // Worlds holding links into this one
+    void dropLinksTo(MockWorld* peer);
+};
+
+/**
+ * MockWorldScope: RAII helper that binds a world to the current thread
+ */
+class MockWorldScope
+{
+public:
+    explicit MockWorldScope(MockWorld& world) : previous(MockWorld::current())
+    {
+        MockWorld::bind(&world);
+    }
+    ~MockWorldScope() { MockWorld::bind(previous); }
+
+    MockWorldScope(const MockWorldScope&) = delete;
+    MockWorldScope& operator=(const MockWorldScope&) = delete;
+
+private:
+    MockWorld* previous;
+};
+
+#endif // MOCK_WORLD_H
@@ -0,0 +1,230 @@
+#include "MonteCarloRunner.h"
+#include "Arduino.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#define NATIVE_HAS_FORK 1
+#endif
+
+#ifdef NATIVE_HAS_FORK
+
+struct RunSlot {
+    pid_t pid;
+    int runIndex;
+    int pipeFd;
+    int core;
+};
+
+// core < 0 leaves the worker to the scheduler
+static void pinToCore(int core)
+{
+#ifdef __linux__
+    if (core < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+// Runs in the forked child; never returns
+static void runWorker(const NativeRunOptions& options, int runIndex, int core, int pipeFd,
+                      NativeRunBody body, void* context)
+{
+    pinToCore(core);
+
+    char dir[32];
+    snprintf(dir, sizeof(dir), "run_%d", runIndex);
+    ::mkdir(dir, 0755);
+    if (chdir(dir) != 0) {
+        _exit(2);
+    }
+
+    int console = open("console.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (console >= 0) {
+        dup2(console, STDOUT_FILENO);
+        dup2(console, STDERR_FILENO);
+        close(console);
+    }
+
+    NativeRunOptions& runOptions = nativeRunOptions();
+    runOptions.runIndex = runIndex;
+    runOptions.seed = options.seed + (uint64_t)runIndex;
+    runOptions.seedSet = true;
+    randomSeed((unsigned long)runOptions.seed);
+    srand((unsigned)runOptions.seed);
+
+    // Sinks opened in setup() reopen themselves here as per-run files
+    runNativeRunHooks();
+
+    if (!options.sitlHost.empty() &&
+        !Serial.connectSITL(options.sitlHost.c_str(), options.sitlPort, options.sitlUdp)) {
+        fprintf(stderr, "Cannot connect to SITL simulator at %s:%d\n", options.sitlHost.c_str(), options.sitlPort);
+        _exit(2);
+    }
+
+    NativeRunSummary summary;
+    memset(&summary, 0, sizeof(summary));
+    body(summary, context);
+
+    // A single write below PIPE_BUF is atomic, so the parent sees all or nothing
+    ssize_t written = write(pipeFd, &summary, sizeof(summary));
+    (void)written;
+    close(pipeFd);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(summary.exitCode & 0xff);
+}
+
+static void writeResultRow(FILE* out, int runIndex, uint64_t seed, const NativeRunSummary& s)
+{
+    fprintf(out, "%d,%llu,%s,%d,%llu,%.6f,%.6f,%.3f,%.3f,%.3f,%llu,%llu\n",
+            runIndex, (unsigned long long)seed, s.exitReason, s.exitCode,
+            (unsigned long long)s.iterations, s.virtualSeconds, s.wallSeconds,
+            s.loopP50Micros, s.loopP99Micros, s.loopMaxMicros,
+            (unsigned long long)s.loopOverruns, (unsigned long long)s.missedDeadlines);
+    fflush(out);
+}
+
+int runMonteCarlo(const NativeRunOptions& options, NativeRunBody body, void* context)
+{
+    int runs = options.runs;
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    int jobs = options.jobs > 0 ? options.jobs : cores;
+    if (jobs > runs) jobs = runs;
+
+    FILE* results = fopen("results.csv", "w");
+    if (!results) {
+        fprintf(stderr, "Monte Carlo: cannot create results.csv\n");
+        return 1;
+    }
+    fprintf(results, "run,seed,exit_reason,exit_code,iterations,virtual_time_s,wall_time_s,"
+                     "loop_p50_us,loop_p99_us,loop_max_us,loop_overruns,missed_deadlines\n");
+    fflush(results);
+
+    printf("Monte Carlo: %d runs on %d workers\n", runs, jobs);
+    fflush(stdout);
+    fflush(stderr);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    std::vector<RunSlot> active;
+    // More workers than cores cannot each have one, so none is pinned
+    bool pin = jobs <= cores;
+    std::vector<bool> coreBusy(cores, false);
+    int nextRun = 0;
+    int failed = 0;
+
+    while (nextRun < runs || !active.empty()) {
+        // Fill free worker slots
+        while (nextRun < runs && (int)active.size() < jobs && !nativeShutdownRequested()) {
+            int core = -1;
+            if (pin) {
+                core = 0;
+                while (coreBusy[core]) core++;
+            }
+
+            // Nothing buffered may be inherited, or children would write it out
+            // again: logs, MockFiles and stdio alike
+            runNativeFlushHooks();
+            fflush(nullptr);
+
+            int fds[2];
+            if (pipe(fds) != 0) {
+                perror("Monte Carlo: pipe");
+                break;
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("Monte Carlo: fork");
+                close(fds[0]);
+                close(fds[1]);
+                break;
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                fclose(results);
+                runWorker(options, nextRun, core, fds[1], body, context);
+            }
+            close(fds[1]);
+            if (core >= 0) {
+                coreBusy[core] = true;
+            }
+            active.push_back({pid, nextRun, fds[0], core});
+            nextRun++;
+        }
+        if (active.empty()) {
+            break;
+        }
+
+        int status = 0;
+        pid_t done = waitpid(-1, &status, 0);
+        if (done < 0) {
+            if (errno == EINTR) {
+                continue;  // SIGINT/SIGTERM: stop scheduling, keep reaping
+            }
+            perror("Monte Carlo: waitpid");
+            break;
+        }
+
+        for (size_t i = 0; i < active.size(); i++) {
+            if (active[i].pid != done) {
+                continue;
+            }
+            RunSlot slot = active[i];
+            active.erase(active.begin() + i);
+            if (slot.core >= 0) {
+                coreBusy[slot.core] = false;
+            }
+
+            NativeRunSummary summary;
+            ssize_t got = read(slot.pipeFd, &summary, sizeof(summary));
+            close(slot.pipeFd);
+            if (got != (ssize_t)sizeof(summary)) {
+                memset(&summary, 0, sizeof(summary));
+                snprintf(summary.exitReason, sizeof(summary.exitReason), "crashed");
+                summary.exitCode = WIFSIGNALED(status) ? 128 + WTERMSIG(status)
+                                                       : (WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+                if (summary.exitCode == 0) summary.exitCode = 1;
+            }
+            if (summary.exitCode != 0) {
+                failed++;
+            }
+            writeResultRow(results, slot.runIndex, options.seed + (uint64_t)slot.runIndex, summary);
+            break;
+        }
+    }
+    fclose(results);
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    printf("Monte Carlo: %d runs finished in %.2fs, %d failed, results in results.csv\n", nextRun, wall, failed);
+    fflush(stdout);
+    return failed ? 1 : 0;
+}
+
+#else
+
+int runMonteCarlo(const NativeRunOptions&, NativeRunBody, void*)
+{
+    fprintf(stderr, "Monte Carlo: --runs needs fork() and is not supported on this platform\n");
+    return 2;
+}
+
+#endif // NATIVE_HAS_FORK
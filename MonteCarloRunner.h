@@ -0,0 +1,43 @@
+#ifndef MONTE_CARLO_RUNNER_H
+#define MONTE_CARLO_RUNNER_H
+
+#include "NativeRuntime.h"
+
+/**
+ * Fork-based Monte Carlo runner for native SITL builds
+ *
+ * ArduinoMain.cpp calls runMonteCarlo() after setup() when --runs is given.
+ * Each run is a fork() of the set-up process, so setup() is paid once.
+ * Up to --jobs workers run at a time, each pinned to its own core (Linux)
+ * unless there are more workers than cores. Registered logs and all stdio
+ * streams are flushed before every fork, so no worker writes out data the
+ * parent had buffered.
+ *
+ * Worker i gets seed (--seed + i) and runs inside run_<i>/ under the output
+ * directory, with stdout/stderr redirected to run_<i>/console.log and its
+ * summary in run_<i>/run_summary.json. Relative paths opened after the fork
+ * therefore land in the run's own directory. Before the run starts the
+ * worker calls the hooks registered with registerNativeRunHook(): a
+ * NativeFileLog begun in setup() with a relative path uses this to reopen
+ * itself in run_<i>/. Anything else already open from setup() (MockFiles,
+ * logs on absolute paths) is shared by every worker, so such per-run output
+ * should be opened lazily (nativeRunOptions().runIndex tells the firmware
+ * which run it is).
+ *
+ * The parent collects each worker's NativeRunSummary over a pipe and writes
+ * one row per run to results.csv. A worker that dies without reporting is
+ * listed with exit reason "crashed".
+ */
+
+/**
+ * Body of one run: executes loop() until a limit is hit and fills the summary
+ */
+typedef void (*NativeRunBody)(NativeRunSummary& summary, void* context);
+
+/**
+ * Run options.runs forked copies of the current process
+ * @return 0 if every run exited with code 0, 1 otherwise
+ */
+int runMonteCarlo(const NativeRunOptions& options, NativeRunBody body, void* context);
+
+#endif // MONTE_CARLO_RUNNER_H
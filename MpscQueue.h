@@ -0,0 +1,90 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+
+/**
+ * MpscNode: Link embedded at the start of every MpscQueue element
+ */
+struct MpscNode
+{
+    std::atomic<MpscNode*> next{nullptr};
+};
+
+/**
+ * MpscQueue: Intrusive multi-producer single-consumer queue (Vyukov)
+ *
+ * push() is wait-free: one atomic exchange and one store, from any number of
+ * threads. pop() must only be called from one consumer thread. Elements come
+ * out in the order their exchanges happened.
+ *
+ * A producer preempted between its two steps briefly hides the elements
+ * queued after it: pop() returns nullptr until it finishes, so consumers
+ * should poll again rather than treat nullptr as "drained for good".
+ *
+ * The queue does not own its elements; whoever pops a node frees it.
+ */
+class MpscQueue
+{
+public:
+    MpscQueue() : head(&stub), tail(&stub) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(MpscNode* node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @return The oldest element, or nullptr if none is available yet
+     */
+    MpscNode* pop()
+    {
+        MpscNode* first = tail;
+        MpscNode* next = first->next.load(std::memory_order_acquire);
+        if (first == &stub) {
+            if (!next) {
+                return nullptr;
+            }
+            tail = next;
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            return first;
+        }
+        if (first != head.load(std::memory_order_acquire)) {
+            return nullptr;  // A push is halfway done
+        }
+        // first is the last element: put the stub behind it so it can be unlinked
+        push(&stub);
+        next = first->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return first;
+        }
+        return nullptr;
+    }
+
+    /**
+     * True if nothing is queued, counting pushes that are halfway done.
+     * Consumer thread only.
+     */
+    bool empty() const
+    {
+        // Anything but the stub at tail is an element not yet returned
+        return tail == &stub && head.load(std::memory_order_acquire) == &stub;
+    }
+
+private:
+    std::atomic<MpscNode*> head;  // Last pushed, shared by producers
+    MpscNode* tail;               // Next to pop, consumer only
+    MpscNode stub;
+};
+
+#endif // MPSC_QUEUE_H
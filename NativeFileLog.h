@@ -1,82 +1,746 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <RecordData/Logging/LoggingBackend/ILogSink.h>
+#include "Arduino.h"
+#include "NativeRuntime.h"
+#include "IoStats.h"
+#include "FramedLog.h"
+#include "MpscQueue.h"
+#include "WakeSignal.h"
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+/**
+ * Options for NativeFileLog
+ *
+ * With a size or time limit set, the log is written as numbered segments
+ * next to the configured path ("flight.log" becomes "flight.0000.log",
+ * "flight.0001.log", ...) and every segment is recorded in "flight.log.index"
+ * with its micros() time range. Rotation happens between write() calls, so a
+ * record written in one call never straddles two segments.
+ */
+struct NativeFileLogOptions
+{
+    uint64_t segmentBytes = 0;      // Rotate once a segment holds this many bytes, 0 for no limit
+    uint64_t segmentMicros = 0;     // Rotate after this much micros() time, 0 for no limit
+    uint64_t preallocateBytes = 0;  // Disk space reserved per segment (fallocate, Linux only)
+
+    // Queue writes for a background writer thread instead of writing inline
+    bool async = false;
+    uint64_t maxQueuedBytes = 64 * 1024 * 1024;  // Producers wait for the writer past this backlog
+
+    // Frame each write() as a timestamped, CRC-checked record and keep a time
+    // index per file, for FramedLogReader (see FramedLog.h)
+    bool framed = false;
+    uint64_t indexIntervalBytes = FrameWriter::DEFAULT_INDEX_INTERVAL;
+};
+
+/**
+ * One segment listed in a NativeFileLog index
+ */
+struct NativeLogSegment
+{
+    std::string path;
+    uint64_t firstMicros = 0;
+    uint64_t lastMicros = UINT64_MAX;  // UINT64_MAX if the segment was never closed
+    uint64_t bytes = 0;
+    bool complete = false;
+};
+
+/**
+ * NativeLogIndex: Reader for the segment index of a segmented NativeFileLog
+ *
+ * The index is append-only text, one line when a segment opens and one when
+ * it closes:
+ *   segment <file> <firstMicros>
+ *   end <file> <lastMicros> <bytes>
+ * A segment without an "end" line (crash, or still being written) is
+ * reported as incomplete and matches every time range after its start.
+ */
+class NativeLogIndex
+{
+public:
+    /**
+     * @param logPath Path the log was configured with (not the index file)
+     */
+    explicit NativeLogIndex(const std::string &logPath)
+    {
+        std::ifstream in(logPath + ".index");
+        ok_ = in.is_open();
+        std::filesystem::path dir = std::filesystem::path(logPath).parent_path();
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            std::string kind, name;
+            fields >> kind >> name;
+            if (kind == "segment")
+            {
+                NativeLogSegment segment;
+                segment.path = (dir / name).string();
+                fields >> segment.firstMicros;
+                segments_.push_back(segment);
+            }
+            else if (kind == "end" && !segments_.empty())
+            {
+                NativeLogSegment &segment = segments_.back();
+                fields >> segment.lastMicros >> segment.bytes;
+                segment.complete = true;
+            }
+        }
+        for (NativeLogSegment &segment : segments_)
+        {
+            std::error_code ec;
+            if (!segment.complete)
+                segment.bytes = std::filesystem::file_size(segment.path, ec);
+            if (ec)
+                segment.bytes = 0;
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+    const std::vector<NativeLogSegment> &segments() const { return segments_; }
+
+    /**
+     * Segments holding data from [fromMicros, toMicros], in write order
+     */
+    std::vector<NativeLogSegment> segmentsBetween(uint64_t fromMicros, uint64_t toMicros) const
+    {
+        std::vector<NativeLogSegment> result;
+        for (const NativeLogSegment &segment : segments_)
+        {
+            if (segment.firstMicros <= toMicros && segment.lastMicros >= fromMicros)
+                result.push_back(segment);
+        }
+        return result;
+    }
+
+private:
+    bool ok_ = false;
+    std::vector<NativeLogSegment> segments_;
+};
+
+/**
+ * NativeFileLog: ILogSink writing to a host file
+ *
+ * By default write() goes straight into the ofstream and the log must only be
+ * used from one thread. With NativeFileLogOptions::async, write() copies the
+ * record into a lock-free MPSC queue (see MpscQueue.h) and returns; a writer
+ * thread owned by the log drains the queue into the ofstream every 10 ms, or
+ * as soon as 64 KB are queued, and the stream's 256 KB buffer turns many
+ * small records into few large file writes. Any number of
+ * threads may then write concurrently: each write() call lands in the file
+ * whole and never interleaves with another, so emit one record per call
+ * (printf) rather than building it from several print()s.
+ *
+ * In async mode flush() and rotate() wait until the writer has handled every
+ * record queued before the call. begin() and end() must not race with
+ * writers.
+ *
+ * Begun with a relative path, the log reopens itself inside each Monte Carlo
+ * worker's run directory (see MonteCarloRunner.h), so every run gets its
+ * own file. Logs on absolute paths stay shared by all runs.
+ *
+ * fork() is safe: every open log is flushed first, so neither side writes
+ * out the other's buffered data again, and an async log's writer thread is
+ * stopped before the fork and started again in both parent and child.
+ * Records other threads write while the fork is in progress are refused.
+ */
 class NativeFileLog : public astra::ILogSink
 {
+    static constexpr size_t STREAM_BUFFER_SIZE = 256 * 1024;
+    static constexpr uint64_t WAKE_BYTES = 64 * 1024;      // Backlog that wakes the writer early
+    static constexpr int WRITER_PERIOD_MS = 10;           // Writer drains at least this often
+
+    // One queued write(), or a flush()/rotate() request waiting on the writer
+    struct QueuedRecord : MpscNode
+    {
+        enum Kind { Data, Flush, Rotate } kind = Data;
+        uint64_t micros = 0;
+        size_t length = 0;
+        bool done = false;  // Control records: set by the writer, guarded by wake_.lock()
+
+        uint8_t *data() { return reinterpret_cast<uint8_t *>(this + 1); }
+    };
+
     std::string path_;
+    std::vector<char> streamBuffer_;  // Declared before ofs_ so it outlives the stream
     std::ofstream ofs_;
     bool started_ = false;
+    std::shared_ptr<IoStats> stats_;
+    std::unique_ptr<FrameWriter> framer_;
+
+    NativeFileLogOptions options_;
+    int segmentNumber_ = 0;
+    std::string segmentPath_;
+    uint64_t segmentSize_ = 0;
+    uint64_t segmentStartMicros_ = 0;
+    uint64_t lastWriteMicros_ = 0;
+
+    // Async mode
+    MpscQueue queue_;
+    std::thread writer_;
+    std::atomic<bool> accepting_{false};
+    std::atomic<int> producers_{0};  // Inside enqueue()/request() up to their push
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> failed_{false};
+    std::atomic<uint64_t> queuedBytes_{0};
+    WakeSignal wake_;
+    std::condition_variable handled_;
+    bool restartAfterFork_ = false;  // Guarded by the fork registry lock
 
 public:
     explicit NativeFileLog(std::string path) : path_(std::move(path)) {}
+    NativeFileLog(std::string path, const NativeFileLogOptions &options)
+        : path_(std::move(path)), options_(options) {}
     ~NativeFileLog() { end(); }
 
     NativeFileLog(const NativeFileLog &) = delete;
     NativeFileLog &operator=(const NativeFileLog &) = delete;
-    NativeFileLog(NativeFileLog &&other) noexcept
-        : path_(std::move(other.path_)), ofs_(std::move(other.ofs_)), started_(other.started_)
-    {
-        other.started_ = false;
-    }
+    NativeFileLog(NativeFileLog &&other) noexcept { *this = std::move(other); }
     NativeFileLog &operator=(NativeFileLog &&other) noexcept
     {
         if (this != &other)
         {
             end();
+            // The writer thread is bound to other; restart it here once the stream has moved
+            other.stopWriter();
+            unregisterNativeFlushHook(&other);
+            unregisterNativeRunHook(&other);
+            other.trackForFork(false);
             path_ = std::move(other.path_);
             ofs_ = std::move(other.ofs_);
+            streamBuffer_ = std::move(other.streamBuffer_);
             started_ = other.started_;
+            stats_ = std::move(other.stats_);
+            framer_ = std::move(other.framer_);
+            moveSegmentState(other);
             other.started_ = false;
+            if (started_)
+            {
+                registerHooks();
+                if (options_.async)
+                    startWriter();
+            }
         }
         return *this;
     }
 
     bool begin() override
     {
-        ofs_.open(path_, std::ios::binary | std::ios::out | std::ios::app);
-        // Optional: speed up large writes in native tests
-        static std::vector<char> buf(256 * 1024);
-        ofs_.rdbuf()->pubsetbuf(buf.data(), buf.size());
+        if (segmented())
+        {
+            // Continue after the segments of an earlier run
+            segmentNumber_ = static_cast<int>(NativeLogIndex(path_).segments().size());
+            openSegment(micros());
+        }
+        else
+        {
+            setStreamBuffer();
+            ofs_.open(path_, std::ios::binary | std::ios::out | std::ios::app);
+            startFraming(path_);
+        }
         started_ = ofs_.is_open();
+        if (started_)
+        {
+            registerHooks();
+            stats_ = IoStats::forPath(path_);
+            if (options_.async)
+                startWriter();
+        }
         return started_;
     }
 
     bool end() override
     {
+        unregisterNativeFlushHook(this);
+        unregisterNativeRunHook(this);
+        trackForFork(false);
+        stopWriter();
         if (ofs_.is_open())
-            ofs_.close();
+        {
+            if (segmented())
+                closeSegment();
+            else
+                ofs_.close();
+        }
+        framer_.reset();
         started_ = false;
         return true;
     }
 
-    bool ok() const override { return started_ && ofs_.good(); }
+    bool ok() const override
+    {
+        if (!started_)
+            return false;
+        return writer_.joinable() ? !failed_.load(std::memory_order_relaxed) : ofs_.good();
+    }
 
     bool wantsPrefix() const override { return false; }
 
     void flush() override
     {
+        // Dispatch on the option, not the thread: while a fork stops the
+        // writer, other threads must be refused rather than touch the stream
+        if (options_.async)
+        {
+            request(QueuedRecord::Flush);
+            return;
+        }
         if (ofs_.is_open())
-            ofs_.flush();
+            flushStream();
     }
 
     size_t write(uint8_t b) override
     {
-        if (!ofs_.is_open())
-            return 0;
-        ofs_.write(reinterpret_cast<const char *>(&b), 1);
-        return ofs_.good() ? 1 : 0;
+        return write(&b, 1);
     }
 
     size_t write(const uint8_t *buf, size_t n) override
     {
+        if (options_.async)
+            return enqueue(buf, n);
         if (!ofs_.is_open())
             return 0;
-        ofs_.write(reinterpret_cast<const char *>(buf), static_cast<std::streamsize>(n));
+        stats_->recordWrite(n);
+        emit(buf, n, timestamped() ? micros() : 0);
         return ofs_.good() ? n : 0;
     }
 
     using Print::write; // keep other Print overloads visible
+
+    // I/O counters for this log's path (see IoStats.h), nullptr before begin()
+    IoStats *stats() const { return stats_.get(); }
+
+    bool segmented() const { return options_.segmentBytes || options_.segmentMicros; }
+
+    bool async() const { return writer_.joinable(); }
+
+    bool framed() const { return options_.framed; }
+
+    // Bytes queued for the writer thread and not yet handed to the stream
+    uint64_t queuedBytes() const { return queuedBytes_.load(std::memory_order_relaxed); }
+
+    // File currently written to (the configured path when not segmented)
+    const std::string &currentPath() const { return segmented() ? segmentPath_ : path_; }
+
+    /**
+     * Close the current segment and start the next one
+     */
+    void rotate()
+    {
+        if (options_.async)
+        {
+            if (segmented())
+                request(QueuedRecord::Rotate);
+            return;
+        }
+        if (ofs_.is_open() && segmented())
+            rotateAt(micros());
+    }
+
+private:
+    static void flushHook(void *self) { static_cast<NativeFileLog *>(self)->flush(); }
+    static void runHook(void *self) { static_cast<NativeFileLog *>(self)->reopenForRun(); }
+
+    void registerHooks()
+    {
+        // Flushed on clean native shutdown (see NativeRuntime.h)
+        registerNativeFlushHook(this, flushHook);
+        if (std::filesystem::path(path_).is_relative())
+            registerNativeRunHook(this, runHook);
+        trackForFork(true);
+    }
+
+    // In a Monte Carlo worker, now inside its run directory: leave the file
+    // inherited from setup() to the parent and begin again on the same
+    // relative path. It was flushed before the fork, so closing the child's
+    // copy writes nothing.
+    void reopenForRun()
+    {
+        if (!started_)
+            return;
+        stopWriter();
+        ofs_.close();
+        framer_.reset();
+        started_ = false;
+        std::error_code ec;
+        std::filesystem::path dir = std::filesystem::path(path_).parent_path();
+        if (!dir.empty())
+            std::filesystem::create_directories(dir, ec);
+        begin();
+    }
+
+    void setStreamBuffer()
+    {
+        // Per instance, and installed before open(): libstdc++ ignores
+        // pubsetbuf() on an open filebuf
+        if (streamBuffer_.empty())
+            streamBuffer_.resize(STREAM_BUFFER_SIZE);
+        ofs_.rdbuf()->pubsetbuf(streamBuffer_.data(), static_cast<std::streamsize>(streamBuffer_.size()));
+    }
+
+    void flushStream()
+    {
+        auto start = std::chrono::steady_clock::now();
+        ofs_.flush();
+        // Index entries go out after the data they point at
+        if (framer_)
+            framer_->flush();
+        stats_->recordFlush(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    // Segment rotation and framing need each record's write time
+    bool timestamped() const { return segmented() || options_.framed; }
+
+    // Write one record to the stream: framed if enabled, then segment bookkeeping
+    void emit(const uint8_t *data, size_t n, uint64_t nowMicros)
+    {
+        size_t bytes = n;
+        if (framer_)
+        {
+            uint8_t header[FrameWriter::HEADER_SIZE];
+            framer_->frame(data, n, nowMicros, header);
+            ofs_.write(reinterpret_cast<const char *>(header), sizeof(header));
+            bytes += sizeof(header);
+        }
+        ofs_.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(n));
+        if (segmented())
+            afterSegmentWrite(bytes, nowMicros);
+    }
+
+    // Index the file just opened, continuing after its current contents
+    void startFraming(const std::string &path)
+    {
+        if (!options_.framed || !ofs_.is_open())
+            return;
+        std::error_code ec;
+        uint64_t length = std::filesystem::file_size(path, ec);
+        framer_.reset(new FrameWriter(options_.indexIntervalBytes));
+        if (!framer_->open(path, ec ? 0 : length))
+            framer_.reset();
+    }
+
+    void moveSegmentState(NativeFileLog &other)
+    {
+        options_ = other.options_;
+        segmentNumber_ = other.segmentNumber_;
+        segmentPath_ = std::move(other.segmentPath_);
+        segmentSize_ = other.segmentSize_;
+        segmentStartMicros_ = other.segmentStartMicros_;
+        lastWriteMicros_ = other.lastWriteMicros_;
+    }
+
+    // ----- Async writer -----
+
+    void startWriter()
+    {
+        failed_.store(false);
+        stopping_.store(false);
+        accepting_.store(true, std::memory_order_release);
+        writer_ = std::thread(&NativeFileLog::writerLoop, this);
+    }
+
+    void stopWriter()
+    {
+        if (!writer_.joinable())
+            return;
+        accepting_.store(false);
+        stopping_.store(true);
+        wake_.wake();
+        writer_.join();
+        // Catch records from producers that raced with the shutdown: wait for
+        // any that passed the accepting_ check to finish pushing, then drain.
+        // pop() returns nullptr while a push is halfway done, so poll until
+        // the queue is really empty.
+        while (producers_.load() != 0)
+            std::this_thread::yield();
+        while (!queue_.empty())
+        {
+            if (MpscNode *node = queue_.pop())
+                handle(static_cast<QueuedRecord *>(node));
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    size_t enqueue(const uint8_t *buf, size_t n)
+    {
+        // Counted before the check so stopWriter() can wait for us to push
+        producers_.fetch_add(1);
+        if (!accepting_.load())
+        {
+            producers_.fetch_sub(1);
+            return 0;
+        }
+        // Backpressure instead of unbounded memory when the disk cannot keep
+        // up. Give up waiting once the writer stops: stopWriter() drains us.
+        while (queuedBytes_.load(std::memory_order_relaxed) > options_.maxQueuedBytes &&
+               !failed_.load(std::memory_order_relaxed) && accepting_.load(std::memory_order_relaxed))
+        {
+            wake_.wake();
+            std::this_thread::yield();
+        }
+        void *memory = ::operator new(sizeof(QueuedRecord) + n);
+        QueuedRecord *record = new (memory) QueuedRecord();
+        record->micros = timestamped() ? micros() : 0;
+        record->length = n;
+        memcpy(record->data(), buf, n);
+        uint64_t queued = queuedBytes_.fetch_add(n, std::memory_order_relaxed) + n;
+        queue_.push(record);
+        producers_.fetch_sub(1);
+        stats_->recordWrite(n);
+        // Worth waking the writer early for a full batch only
+        if (queued >= WAKE_BYTES)
+            wake_.wakeIfIdle();
+        return failed_.load(std::memory_order_relaxed) ? 0 : n;
+    }
+
+    // Queue a control record and wait until the writer has handled it, and so
+    // everything queued before it
+    void request(QueuedRecord::Kind kind)
+    {
+        producers_.fetch_add(1);
+        if (!accepting_.load())
+        {
+            producers_.fetch_sub(1);
+            return;
+        }
+        QueuedRecord record;
+        record.kind = kind;
+        record.micros = micros();
+        queue_.push(&record);
+        producers_.fetch_sub(1);
+        wake_.wake();
+        std::unique_lock<std::mutex> lock(wake_.lock());
+        handled_.wait(lock, [&record] { return record.done; });
+    }
+
+    void writerLoop()
+    {
+        for (;;)
+        {
+            bool worked = false;
+            while (MpscNode *node = queue_.pop())
+            {
+                handle(static_cast<QueuedRecord *>(node));
+                worked = true;
+            }
+            if (worked)
+                continue;
+            if (stopping_.load() && queue_.empty())
+                return;
+            wake_.sleep(std::chrono::milliseconds(WRITER_PERIOD_MS),
+                        [this] { return queue_.empty() && !stopping_.load(); });
+        }
+    }
+
+    void handle(QueuedRecord *record)
+    {
+        if (record->kind != QueuedRecord::Data)
+        {
+            if (record->kind == QueuedRecord::Flush)
+                flushStream();
+            else if (ofs_.is_open())
+                rotateAt(record->micros);
+            // The record lives on the requester's stack: do not touch it after done
+            {
+                std::lock_guard<std::mutex> guard(wake_.lock());
+                record->done = true;
+            }
+            handled_.notify_all();
+            return;
+        }
+        emit(record->data(), record->length, record->micros);
+        if (!ofs_.good())
+            failed_.store(true, std::memory_order_relaxed);
+        queuedBytes_.fetch_sub(record->length, std::memory_order_relaxed);
+        record->~QueuedRecord();
+        ::operator delete(record);
+    }
+
+    // ----- fork() -----
+
+    struct ForkRegistry
+    {
+        std::mutex lock;
+        std::vector<NativeFileLog *> logs;
+    };
+
+    static ForkRegistry &forkRegistry()
+    {
+        // Never destroyed: logs with static storage close after it would be
+        static ForkRegistry *registry = new ForkRegistry();
+#if defined(__unix__) || defined(__APPLE__)
+        static bool installed = pthread_atfork(prepareFork, afterFork, afterFork) == 0;
+        (void)installed;
+#endif
+        return *registry;
+    }
+
+    void trackForFork(bool open)
+    {
+        ForkRegistry &registry = forkRegistry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        std::vector<NativeFileLog *> &logs = registry.logs;
+        for (size_t i = 0; i < logs.size(); i++)
+        {
+            if (logs[i] == this)
+            {
+                if (!open)
+                    logs.erase(logs.begin() + i);
+                return;
+            }
+        }
+        if (open)
+            logs.push_back(this);
+    }
+
+    // The child would get the writer's std::thread but not the thread itself,
+    // so the writer is joined here and started again after the fork. The
+    // registry lock is held across fork() so no log opens or closes meanwhile.
+    static void prepareFork()
+    {
+        ForkRegistry &registry = forkRegistry();
+        registry.lock.lock();
+        for (NativeFileLog *log : registry.logs)
+        {
+            log->restartAfterFork_ = log->writer_.joinable();
+            log->stopWriter();
+            if (log->ofs_.is_open())
+                log->flushStream();
+        }
+    }
+
+    static void afterFork()
+    {
+        ForkRegistry &registry = forkRegistry();
+        for (NativeFileLog *log : registry.logs)
+        {
+            if (log->restartAfterFork_)
+                log->startWriter();
+            log->restartAfterFork_ = false;
+        }
+        registry.lock.unlock();
+    }
+
+    // ----- Segments -----
+
+    // "dir/flight.log" -> "dir/flight.0003.log"
+    std::string segmentPathFor(int number) const
+    {
+        std::filesystem::path p(path_);
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), ".%04d", number);
+        std::filesystem::path name = p.stem();
+        name += suffix;
+        name += p.extension();
+        return (p.parent_path() / name).string();
+    }
+
+    void appendIndex(const std::string &line)
+    {
+        std::ofstream index(path_ + ".index", std::ios::out | std::ios::app);
+        index << line << '\n';
+    }
+
+    void openSegment(uint64_t startMicros)
+    {
+        segmentPath_ = segmentPathFor(segmentNumber_);
+        // Truncating would release the reserved blocks again
+        bool reserved = preallocate(segmentPath_);
+        setStreamBuffer();
+        ofs_.open(segmentPath_, std::ios::binary | std::ios::out | (reserved ? std::ios::app : std::ios::trunc));
+        startFraming(segmentPath_);
+        segmentSize_ = 0;
+        segmentStartMicros_ = startMicros;
+        lastWriteMicros_ = segmentStartMicros_;
+        appendIndex("segment " + std::filesystem::path(segmentPath_).filename().string() + " " +
+                    std::to_string(segmentStartMicros_));
+    }
+
+    void closeSegment()
+    {
+        ofs_.close();
+        framer_.reset();
+        releasePreallocation(segmentPath_);
+        appendIndex("end " + std::filesystem::path(segmentPath_).filename().string() + " " +
+                    std::to_string(lastWriteMicros_) + " " + std::to_string(segmentSize_));
+    }
+
+    void rotateAt(uint64_t nowMicros)
+    {
+        closeSegment();
+        segmentNumber_++;
+        openSegment(nowMicros);
+    }
+
+    // nowMicros: when the record was written (queued, in async mode)
+    void afterSegmentWrite(size_t n, uint64_t nowMicros)
+    {
+        segmentSize_ += n;
+        lastWriteMicros_ = nowMicros;
+        bool full = options_.segmentBytes && segmentSize_ >= options_.segmentBytes;
+        bool expired = options_.segmentMicros && lastWriteMicros_ - segmentStartMicros_ >= options_.segmentMicros;
+        if (full || expired)
+            rotateAt(nowMicros);
+    }
+
+    // Reserve the segment's blocks up front so long runs do not fragment;
+    // KEEP_SIZE leaves the visible file length at the bytes actually written
+    bool preallocate(const std::string &path)
+    {
+#ifdef __linux__
+        if (!options_.preallocateBytes)
+            return false;
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return false;
+        bool reserved = fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(options_.preallocateBytes)) == 0;
+        if (!reserved)
+            perror("NativeFileLog: fallocate");
+        ::close(fd);
+        return reserved;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    // Give back the reserved space past the end of a closed segment
+    void releasePreallocation(const std::string &path)
+    {
+#ifdef __linux__
+        if (!options_.preallocateBytes || segmentSize_ >= options_.preallocateBytes)
+            return;
+        // Truncating to the current length drops blocks reserved past EOF
+        // (punching a hole does not reach beyond EOF on ext4)
+        if (::truncate(path.c_str(), static_cast<off_t>(segmentSize_)) != 0)
+            perror("NativeFileLog: truncate");
+#else
+        (void)path;
+#endif
+    }
 };
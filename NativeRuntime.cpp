@@ -0,0 +1,341 @@
+#include "NativeRuntime.h"
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+static NativeRunOptions runOptions;
+
+static std::atomic<bool> shutdownRequested(false);
+static std::atomic<const char*> shutdownReason(nullptr);
+static std::atomic<int> shutdownExitCode(0);
+static volatile sig_atomic_t shutdownSignal = 0;
+
+struct FlushHook {
+    void* owner;
+    void (*hook)(void*);
+};
+static std::mutex flushHooksLock;  // Guards both hook lists
+static std::vector<FlushHook>& flushHooks()
+{
+    // Function-local so hooks registered by static constructors are safe
+    static std::vector<FlushHook> hooks;
+    return hooks;
+}
+static std::vector<FlushHook>& runStartHooks()
+{
+    static std::vector<FlushHook> hooks;
+    return hooks;
+}
+
+NativeRunOptions& nativeRunOptions()
+{
+    return runOptions;
+}
+
+void printNativeUsage(FILE* out, const char* program)
+{
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "  --duration <s>         stop after <s> seconds of virtual time\n"
+            "  --iterations <n>       stop after <n> loop() iterations\n"
+            "  --seed <n>             seed random() and rand()\n"
+            "  --sitl <host:port>     connect Serial to a SITL simulator over TCP before setup()\n"
+            "  --sitl-udp <host:port> same, over UDP datagrams\n"
+            "  --output-dir <dir>     create <dir> and run inside it\n"
+            "  --summary <file>       run summary path (default run_summary.json, '-' for stdout)\n"
+            "  --rate <hz>            fixed-rate loop scheduling in virtual time\n"
+            "  --slowdown <x>         host-to-target CPU slowdown factor\n"
+            "  --realtime             pace virtual time against the wall clock\n"
+            "  --profile              profile loop() iterations\n"
+            "  --budget-us <us>       per-iteration budget for the profiler\n"
+            "  --runs <n>             fork <n> Monte Carlo runs after setup(), seeds seed..seed+n-1\n"
+            "  --jobs <n>             concurrent Monte Carlo workers (default: core count)\n"
+            "  --help                 show this message\n",
+            program);
+}
+
+// Whole-string number parsing: trailing characters, signs on unsigned values
+// and out-of-range values are errors rather than silently becoming 0
+static bool parseUnsigned(const char* text, uint64_t& out, int base = 10)
+{
+    while (isspace((unsigned char)*text)) text++;
+    if (*text == '\0' || *text == '-' || *text == '+') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, base);
+    if (errno == ERANGE || *end != '\0') {
+        return false;
+    }
+    out = (uint64_t)value;
+    return true;
+}
+
+static bool parseInt(const char* text, int minValue, int maxValue, int& out)
+{
+    uint64_t value;
+    if (!parseUnsigned(text, value) || value < (uint64_t)minValue || value > (uint64_t)maxValue) {
+        return false;
+    }
+    out = (int)value;
+    return true;
+}
+
+// minValue is exclusive when positive is set
+static bool parseDouble(const char* text, double minValue, bool positive, double& out)
+{
+    char* end = nullptr;
+    errno = 0;
+    double value = strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(value)) {
+        return false;
+    }
+    if (positive ? value <= minValue : value < minValue) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+static bool parseEndpoint(const char* value, std::string& host, int& port)
+{
+    const char* colon = strrchr(value, ':');
+    if (!colon || colon == value) {
+        return false;
+    }
+    host.assign(value, colon - value);
+    return parseInt(colon + 1, 1, 65535, port);
+}
+
+int parseNativeRunOptions(int argc, char** argv, NativeRunOptions& options)
+{
+    const char* program = argc > 0 ? argv[0] : "firmware";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value;
+        bool hasValue = false;
+
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") == 0 && eq != std::string::npos) {
+            value = arg.substr(eq + 1);
+            arg = arg.substr(0, eq);
+            hasValue = true;
+        }
+
+        // Flags without a value
+        if (arg == "--help" || arg == "-h") {
+            printNativeUsage(stdout, program);
+            return 1;
+        }
+        if (arg == "--realtime") {
+            options.realtime = true;
+            continue;
+        }
+        if (arg == "--profile") {
+            options.profile = true;
+            continue;
+        }
+
+        static const char* const valueOptions[] = {
+            "--duration", "--iterations", "--seed", "--sitl", "--sitl-udp", "--output-dir",
+            "--summary", "--rate", "--slowdown", "--budget-us", "--runs", "--jobs",
+        };
+        bool known = false;
+        for (const char* name : valueOptions) {
+            known = known || arg == name;
+        }
+        if (!known) {
+            fprintf(stderr, "%s: unknown option '%s'\n", program, arg.c_str());
+            printNativeUsage(stderr, program);
+            return 2;
+        }
+
+        if (!hasValue) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "%s: missing value for %s\n", program, arg.c_str());
+                printNativeUsage(stderr, program);
+                return 2;
+            }
+            value = argv[++i];
+        }
+
+        const char* text = value.c_str();
+        bool valid = true;
+        const char* expected = nullptr;
+        if (arg == "--duration") {
+            valid = parseDouble(text, 0.0, false, options.durationSeconds);
+            expected = "a number of seconds >= 0";
+        } else if (arg == "--iterations") {
+            valid = parseUnsigned(text, options.maxIterations);
+            expected = "a non-negative integer";
+        } else if (arg == "--seed") {
+            valid = parseUnsigned(text, options.seed, 0);
+            options.seedSet = valid;
+            expected = "a non-negative integer";
+        } else if (arg == "--sitl" || arg == "--sitl-udp") {
+            valid = parseEndpoint(text, options.sitlHost, options.sitlPort);
+            options.sitlUdp = (arg == "--sitl-udp");
+            expected = "host:port";
+        } else if (arg == "--output-dir") {
+            options.outputDir = value;
+        } else if (arg == "--summary") {
+            options.summaryPath = value;
+        } else if (arg == "--rate") {
+            valid = parseDouble(text, 0.0, true, options.rateHz);
+            expected = "a rate in Hz > 0";
+        } else if (arg == "--slowdown") {
+            valid = parseDouble(text, 0.0, true, options.slowdown);
+            expected = "a factor > 0";
+        } else if (arg == "--budget-us") {
+            valid = parseUnsigned(text, options.budgetMicros);
+            options.profile = true;
+            expected = "a non-negative integer";
+        } else if (arg == "--runs") {
+            valid = parseInt(text, 1, INT_MAX, options.runs);
+            expected = "an integer >= 1";
+        } else if (arg == "--jobs") {
+            valid = parseInt(text, 1, INT_MAX, options.jobs);
+            expected = "an integer >= 1";
+        }
+        if (!valid) {
+            fprintf(stderr, "%s: invalid value '%s' for %s (expected %s)\n", program, text, arg.c_str(), expected);
+            printNativeUsage(stderr, program);
+            return 2;
+        }
+    }
+    return 0;
+}
+
+void requestNativeShutdown(const char* reason, int exitCode)
+{
+    const char* expected = nullptr;
+    if (shutdownReason.compare_exchange_strong(expected, reason ? reason : "requested")) {
+        shutdownExitCode.store(exitCode);
+    }
+    shutdownRequested.store(true);
+}
+
+void requestNativeShutdownFromSignal(int sig)
+{
+    shutdownSignal = sig;
+}
+
+bool nativeShutdownRequested()
+{
+    return shutdownRequested.load(std::memory_order_relaxed) || shutdownSignal != 0;
+}
+
+const char* nativeShutdownReason()
+{
+    const char* reason = shutdownReason.load();
+    if (reason) {
+        return reason;
+    }
+    return shutdownSignal ? "signal" : "running";
+}
+
+int nativeShutdownExitCode()
+{
+    if (shutdownReason.load()) {
+        return shutdownExitCode.load();
+    }
+    return shutdownSignal ? 128 + shutdownSignal : 0;
+}
+
+static void registerHook(std::vector<FlushHook>& hooks, void* owner, void (*hook)(void*))
+{
+    std::lock_guard<std::mutex> guard(flushHooksLock);
+    for (FlushHook& entry : hooks) {
+        if (entry.owner == owner) {
+            entry.hook = hook;
+            return;
+        }
+    }
+    hooks.push_back({owner, hook});
+}
+
+static void unregisterHook(std::vector<FlushHook>& hooks, void* owner)
+{
+    std::lock_guard<std::mutex> guard(flushHooksLock);
+    for (size_t i = 0; i < hooks.size(); i++) {
+        if (hooks[i].owner == owner) {
+            hooks.erase(hooks.begin() + i);
+            return;
+        }
+    }
+}
+
+static void callHooks(std::vector<FlushHook>& list)
+{
+    // Copy so hooks may unregister themselves
+    std::vector<FlushHook> hooks;
+    {
+        std::lock_guard<std::mutex> guard(flushHooksLock);
+        hooks = list;
+    }
+    for (FlushHook& entry : hooks) {
+        entry.hook(entry.owner);
+    }
+}
+
+void registerNativeFlushHook(void* owner, void (*hook)(void*))
+{
+    registerHook(flushHooks(), owner, hook);
+}
+
+void unregisterNativeFlushHook(void* owner)
+{
+    unregisterHook(flushHooks(), owner);
+}
+
+void runNativeFlushHooks()
+{
+    callHooks(flushHooks());
+}
+
+void registerNativeRunHook(void* owner, void (*hook)(void*))
+{
+    registerHook(runStartHooks(), owner, hook);
+}
+
+void unregisterNativeRunHook(void* owner)
+{
+    unregisterHook(runStartHooks(), owner);
+}
+
+void runNativeRunHooks()
+{
+    callHooks(runStartHooks());
+}
+
+bool writeNativeRunSummary(const NativeRunSummary& summary, const char* path)
+{
+    bool toStdout = path && strcmp(path, "-") == 0;
+    FILE* out = toStdout ? stdout : fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Failed to write run summary to %s\n", path);
+        return false;
+    }
+    fprintf(out,
+            "{\"exit_reason\": \"%s\", \"exit_code\": %d, \"seed\": %llu, \"iterations\": %llu, "
+            "\"virtual_time_s\": %.6f, \"wall_time_s\": %.6f, "
+            "\"loop_p50_us\": %.3f, \"loop_p99_us\": %.3f, \"loop_max_us\": %.3f, \"loop_overruns\": %llu, "
+            "\"missed_deadlines\": %llu}\n",
+            summary.exitReason, summary.exitCode, (unsigned long long)summary.seed,
+            (unsigned long long)summary.iterations, summary.virtualSeconds, summary.wallSeconds,
+            summary.loopP50Micros, summary.loopP99Micros, summary.loopMaxMicros,
+            (unsigned long long)summary.loopOverruns, (unsigned long long)summary.missedDeadlines);
+    if (toStdout) {
+        fflush(out);
+        return true;
+    }
+    return fclose(out) == 0;
+}
@@ -0,0 +1,111 @@
+#ifndef NATIVE_RUNTIME_H
+#define NATIVE_RUNTIME_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * Native run control: command-line options, clean shutdown and run summaries
+ *
+ * ArduinoMain.cpp parses the command line into NativeRunOptions before
+ * setup(), runs loop() until a limit is hit or a shutdown is requested, then
+ * flushes every registered log and writes a machine-readable summary.
+ * Firmware can read the options and request a shutdown itself.
+ */
+struct NativeRunOptions
+{
+    double durationSeconds = 0;    // Virtual-time limit, 0 for none
+    uint64_t maxIterations = 0;    // loop() iteration limit, 0 for none
+    uint64_t seed = 0;
+    bool seedSet = false;
+
+    std::string sitlHost;          // Connect Serial to this simulator before setup()
+    int sitlPort = 0;
+    bool sitlUdp = false;
+
+    std::string outputDir;         // Created if needed and used as working directory
+    std::string summaryPath;       // Defaults to run_summary.json in outputDir
+
+    // Loop profiling and scheduling (override the NATIVE_* environment variables)
+    bool profile = false;
+    uint64_t budgetMicros = 0;
+    double rateHz = 0;
+    double slowdown = 0;
+    bool realtime = false;
+
+    // Monte Carlo runner (see MonteCarloRunner.h)
+    int runs = 0;                  // Forked runs after setup(), 0 for a single run
+    int jobs = 0;                  // Concurrent workers, 0 for the core count
+    int runIndex = -1;             // Index of this run inside a runner, -1 otherwise
+};
+
+/**
+ * Result of one run, written as JSON by writeNativeRunSummary()
+ */
+struct NativeRunSummary
+{
+    char exitReason[32];
+    int exitCode;
+    uint64_t seed;
+    uint64_t iterations;
+    double virtualSeconds;
+    double wallSeconds;
+
+    // Filled when the loop profiler ran
+    double loopP50Micros;
+    double loopP99Micros;
+    double loopMaxMicros;
+    uint64_t loopOverruns;
+
+    // Filled when the loop scheduler ran
+    uint64_t missedDeadlines;
+};
+
+/**
+ * Parse argv into options
+ * @return 0 to continue, 1 if --help was printed, 2 on invalid arguments
+ */
+int parseNativeRunOptions(int argc, char** argv, NativeRunOptions& options);
+
+void printNativeUsage(FILE* out, const char* program);
+
+/**
+ * Options of the current run (defaults when not launched through ArduinoMain)
+ */
+NativeRunOptions& nativeRunOptions();
+
+/**
+ * Ask the main loop to stop after the current iteration
+ * Safe to call from any thread; the first reason wins.
+ */
+void requestNativeShutdown(const char* reason, int exitCode = 0);
+bool nativeShutdownRequested();
+const char* nativeShutdownReason();
+int nativeShutdownExitCode();
+
+/**
+ * Async-signal-safe shutdown request, for SIGINT/SIGTERM handlers
+ */
+void requestNativeShutdownFromSignal(int sig);
+
+/**
+ * Register a callback run on clean shutdown, e.g. to flush an open log
+ * @param owner Key used to unregister; one hook per owner
+ */
+void registerNativeFlushHook(void* owner, void (*hook)(void*));
+void unregisterNativeFlushHook(void* owner);
+void runNativeFlushHooks();
+
+/**
+ * Register a callback run in each Monte Carlo worker once it is inside its
+ * run directory, e.g. to reopen a log begun in setup() as a per-run file
+ * @param owner Key used to unregister; one hook per owner
+ */
+void registerNativeRunHook(void* owner, void (*hook)(void*));
+void unregisterNativeRunHook(void* owner);
+void runNativeRunHooks();
+
+bool writeNativeRunSummary(const NativeRunSummary& summary, const char* path);
+
+#endif // NATIVE_RUNTIME_H
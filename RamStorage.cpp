@@ -0,0 +1,348 @@
+#include "RamStorage.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// RamFileData implementation
+void RamFileData::reserve(size_t end)
+{
+    while (capacity < end) {
+        size_t next = extents.empty() ? FIRST_EXTENT : extentSize.back() * 2;
+        if (next > MAX_EXTENT) next = MAX_EXTENT;
+        // Value-initialized, so gaps left by seeking past the end read as zeros
+        extents.emplace_back(new uint8_t[next]());
+        extentStart.push_back(capacity);
+        extentSize.push_back(next);
+        capacity += next;
+    }
+}
+
+size_t RamFileData::findExtent(size_t offset)
+{
+    // Sequential access stays in the same or the next extent
+    if (lastExtent < extents.size()) {
+        if (offset >= extentStart[lastExtent] && offset < extentStart[lastExtent] + extentSize[lastExtent]) {
+            return lastExtent;
+        }
+        size_t next = lastExtent + 1;
+        if (next < extents.size() && offset >= extentStart[next] && offset < extentStart[next] + extentSize[next]) {
+            lastExtent = next;
+            return next;
+        }
+    }
+    auto it = std::upper_bound(extentStart.begin(), extentStart.end(), offset);
+    lastExtent = (size_t)(it - extentStart.begin()) - 1;
+    return lastExtent;
+}
+
+size_t RamFileData::readAt(size_t offset, uint8_t* out, size_t n)
+{
+    if (offset >= length) return 0;
+    if (n > length - offset) n = length - offset;
+
+    size_t done = 0;
+    while (done < n) {
+        size_t e = findExtent(offset + done);
+        size_t within = offset + done - extentStart[e];
+        size_t chunk = std::min(n - done, extentSize[e] - within);
+        memcpy(out + done, extents[e].get() + within, chunk);
+        done += chunk;
+    }
+    return n;
+}
+
+size_t RamFileData::writeAt(size_t offset, const uint8_t* in, size_t n)
+{
+    reserve(offset + n);
+    size_t done = 0;
+    while (done < n) {
+        size_t e = findExtent(offset + done);
+        size_t within = offset + done - extentStart[e];
+        size_t chunk = std::min(n - done, extentSize[e] - within);
+        memcpy(extents[e].get() + within, in + done, chunk);
+        done += chunk;
+    }
+    if (offset + n > length) length = offset + n;
+    return n;
+}
+
+void RamFileData::truncate()
+{
+    extents.clear();
+    extentStart.clear();
+    extentSize.clear();
+    capacity = 0;
+    length = 0;
+    lastExtent = 0;
+}
+
+// RamFs implementation
+std::string RamFs::normalize(const char* path)
+{
+    std::string out;
+    if (!path) return out;
+    const char* p = path;
+    while (*p) {
+        while (*p == '/') p++;
+        const char* segEnd = p;
+        while (*segEnd && *segEnd != '/') segEnd++;
+        std::string seg(p, segEnd - p);
+        p = segEnd;
+        if (seg.empty() || seg == ".") continue;
+        if (seg == "..") {
+            size_t slash = out.rfind('/');
+            out.erase(slash == std::string::npos ? 0 : slash);
+            continue;
+        }
+        if (!out.empty()) out += '/';
+        out += seg;
+    }
+    return out;
+}
+
+std::string RamFs::parentOf(const std::string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash);
+}
+
+std::shared_ptr<RamFs> RamFs::global()
+{
+    static std::shared_ptr<RamFs> fs = std::make_shared<RamFs>();
+    return fs;
+}
+
+static bool isDirLocked(RamFs& fs, const std::string& path)
+{
+    if (path.empty()) return true;  // Root
+    auto it = fs.nodes.find(path);
+    return it != fs.nodes.end() && it->second.isDir;
+}
+
+// RamFile implementation
+RamFile::RamFile(std::shared_ptr<RamFileData> data, bool readable, bool writable, bool append)
+    : _data(std::move(data)), _readable(readable), _writable(writable), _append(append)
+{
+    if (_append) {
+        std::lock_guard<std::mutex> guard(_data->lock);
+        _pos = _data->size();
+    }
+}
+
+RamFile::RamFile() {}
+
+size_t RamFile::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t RamFile::write(const uint8_t *buffer, size_t size) {
+    if (!_data || !_writable) return 0;
+    std::lock_guard<std::mutex> guard(_data->lock);
+    if (_append) _pos = _data->size();
+    _data->writeAt(_pos, buffer, size);
+    _pos += size;
+    return size;
+}
+
+bool RamFile::flush() {
+    return _data != nullptr;
+}
+
+int RamFile::read() {
+    uint8_t b;
+    return readBytes(&b, 1) == 1 ? b : -1;
+}
+
+int RamFile::readBytes(uint8_t *buffer, size_t length) {
+    if (!_data || !_readable) return 0;
+    std::lock_guard<std::mutex> guard(_data->lock);
+    size_t n = _data->readAt(_pos, buffer, length);
+    _pos += n;
+    return (int)n;
+}
+
+int RamFile::available() {
+    if (!_data) return 0;
+    std::lock_guard<std::mutex> guard(_data->lock);
+    size_t size = _data->size();
+    return size > _pos ? (int)(size - _pos) : 0;
+}
+
+bool RamFile::seek(uint32_t pos) {
+    if (!_data) return false;
+    _pos = pos;
+    return true;
+}
+
+uint32_t RamFile::position() {
+    return _data ? (uint32_t)_pos : 0;
+}
+
+uint32_t RamFile::size() {
+    if (!_data) return 0;
+    std::lock_guard<std::mutex> guard(_data->lock);
+    return (uint32_t)_data->size();
+}
+
+bool RamFile::close() {
+    if (!_data) return false;
+    _data.reset();
+    return true;
+}
+
+bool RamFile::isOpen() const {
+    return _data != nullptr;
+}
+
+// RamStorage implementation
+RamStorage::RamStorage() : fs(std::make_shared<RamFs>()) {}
+RamStorage::RamStorage(std::shared_ptr<RamFs> fs) : fs(std::move(fs)) {}
+
+bool RamStorage::begin() { return true; }
+bool RamStorage::end() { return true; }
+bool RamStorage::ok() const { return true; }
+
+astra::IFile* RamStorage::openRead(const char *filename) {
+    std::string path = RamFs::normalize(filename);
+    std::lock_guard<std::mutex> guard(fs->lock);
+    auto it = fs->nodes.find(path);
+    if (it == fs->nodes.end() || it->second.isDir) {
+        return new RamFile();
+    }
+    return new RamFile(it->second.data, true, false, false);
+}
+
+astra::IFile* RamStorage::openWrite(const char *filename, bool append) {
+    std::string path = RamFs::normalize(filename);
+    std::lock_guard<std::mutex> guard(fs->lock);
+    if (path.empty() || !isDirLocked(*fs, RamFs::parentOf(path))) {
+        return new RamFile();
+    }
+    auto it = fs->nodes.find(path);
+    if (it != fs->nodes.end() && it->second.isDir) {
+        return new RamFile();
+    }
+    if (it == fs->nodes.end()) {
+        it = fs->nodes.emplace(path, RamFs::Node{false, std::make_shared<RamFileData>()}).first;
+    } else if (!append) {
+        std::lock_guard<std::mutex> dataGuard(it->second.data->lock);
+        it->second.data->truncate();
+    }
+    return new RamFile(it->second.data, true, true, append);
+}
+
+bool RamStorage::exists(const char *filename) {
+    std::string path = RamFs::normalize(filename);
+    std::lock_guard<std::mutex> guard(fs->lock);
+    return path.empty() || fs->nodes.count(path) > 0;
+}
+
+bool RamStorage::remove(const char *filename) {
+    std::string path = RamFs::normalize(filename);
+    std::lock_guard<std::mutex> guard(fs->lock);
+    auto it = fs->nodes.find(path);
+    if (it == fs->nodes.end() || it->second.isDir) {
+        return false;
+    }
+    // Open handles keep their data alive, as with unlink() on POSIX
+    fs->nodes.erase(it);
+    return true;
+}
+
+bool RamStorage::mkdir(const char *path) {
+    std::string target = RamFs::normalize(path);
+    std::lock_guard<std::mutex> guard(fs->lock);
+    size_t pos = 0;
+    while (pos != std::string::npos) {
+        pos = target.find('/', pos + 1);
+        std::string prefix = target.substr(0, pos);
+        if (prefix.empty()) continue;
+        auto it = fs->nodes.find(prefix);
+        if (it == fs->nodes.end()) {
+            fs->nodes.emplace(prefix, RamFs::Node{true, nullptr});
+        } else if (!it->second.isDir) {
+            return false;  // A file is in the way
+        }
+    }
+    return true;
+}
+
+bool RamStorage::rmdir(const char *path) {
+    std::string target = RamFs::normalize(path);
+    std::lock_guard<std::mutex> guard(fs->lock);
+    auto it = fs->nodes.find(target);
+    if (target.empty() || it == fs->nodes.end() || !it->second.isDir) {
+        return false;
+    }
+    // Children sort directly after "dir/"
+    auto child = fs->nodes.lower_bound(target + "/");
+    if (child != fs->nodes.end() && child->first.compare(0, target.size() + 1, target + "/") == 0) {
+        return false;
+    }
+    fs->nodes.erase(it);
+    return true;
+}
+
+std::vector<std::string> RamStorage::list(const char *path) {
+    std::string dir = RamFs::normalize(path);
+    std::string prefix = dir.empty() ? std::string() : dir + "/";
+    std::vector<std::string> names;
+    std::lock_guard<std::mutex> guard(fs->lock);
+    for (auto it = fs->nodes.lower_bound(prefix); it != fs->nodes.end(); ++it) {
+        if (it->first.compare(0, prefix.size(), prefix) != 0) break;
+        std::string rest = it->first.substr(prefix.size());
+        if (!rest.empty() && rest.find('/') == std::string::npos) {
+            names.push_back(rest);
+        }
+    }
+    return names;
+}
+
+size_t RamStorage::usedBytes() {
+    size_t total = 0;
+    std::lock_guard<std::mutex> guard(fs->lock);
+    for (auto& entry : fs->nodes) {
+        if (!entry.second.isDir) {
+            std::lock_guard<std::mutex> dataGuard(entry.second.data->lock);
+            total += entry.second.data->size();
+        }
+    }
+    return total;
+}
+
+void RamStorage::clear() {
+    std::lock_guard<std::mutex> guard(fs->lock);
+    fs->nodes.clear();
+}
+
+bool RamStorage::snapshot(const char *hostDir) {
+    namespace stdfs = std::filesystem;
+    std::error_code ec;
+    stdfs::path root(hostDir);
+    stdfs::create_directories(root, ec);
+    if (ec) return false;
+
+    bool allWritten = true;
+    std::lock_guard<std::mutex> guard(fs->lock);
+    // std::map order guarantees parents are created before their children
+    for (auto& entry : fs->nodes) {
+        stdfs::path target = root / entry.first;
+        if (entry.second.isDir) {
+            stdfs::create_directories(target, ec);
+            allWritten = allWritten && !ec;
+            continue;
+        }
+        std::ofstream out(target, std::ios::binary | std::ios::trunc);
+        RamFileData& data = *entry.second.data;
+        std::lock_guard<std::mutex> dataGuard(data.lock);
+        uint8_t chunk[64 * 1024];
+        for (size_t off = 0; off < data.size();) {
+            size_t n = data.readAt(off, chunk, sizeof(chunk));
+            out.write(reinterpret_cast<const char *>(chunk), (std::streamsize)n);
+            off += n;
+        }
+        allWritten = allWritten && out.good();
+    }
+    return allWritten;
+}
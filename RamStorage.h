@@ -0,0 +1,154 @@
+#ifndef RAM_STORAGE_H
+#define RAM_STORAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "RecordData/Storage/IStorage.h"
+#include "RecordData/Storage/IFile.h"
+
+/**
+ * RamFileData: Contents of one in-memory file, stored as a list of extents
+ *
+ * Extents grow geometrically (4 KiB doubling up to 1 MiB), so appending never
+ * copies existing data and a long log costs a few dozen allocations.
+ */
+class RamFileData
+{
+public:
+    size_t size() const { return length; }
+
+    size_t readAt(size_t offset, uint8_t* out, size_t n);
+    size_t writeAt(size_t offset, const uint8_t* in, size_t n);
+    void truncate();
+
+    std::mutex lock;  // Held by RamFile around each access
+
+private:
+    static const size_t FIRST_EXTENT = 4 * 1024;
+    static const size_t MAX_EXTENT = 1024 * 1024;
+
+    size_t findExtent(size_t offset);
+    void reserve(size_t end);
+
+    std::vector<std::unique_ptr<uint8_t[]>> extents;
+    std::vector<size_t> extentStart;  // Offset of each extent's first byte
+    std::vector<size_t> extentSize;
+    size_t capacity = 0;
+    size_t length = 0;
+    size_t lastExtent = 0;  // Cursor for sequential access
+};
+
+/**
+ * RamFs: In-memory directory tree shared by RamStorage instances
+ *
+ * Paths are normalized ("/logs//a.csv", "logs/a.csv" and "./logs/a.csv" are
+ * the same file). The root directory always exists.
+ */
+class RamFs
+{
+public:
+    struct Node {
+        bool isDir;
+        std::shared_ptr<RamFileData> data;
+    };
+
+    static std::string normalize(const char* path);
+    static std::string parentOf(const std::string& path);
+
+    std::mutex lock;
+    std::map<std::string, Node> nodes;  // Keyed by normalized path, root is ""
+
+    /**
+     * Filesystem used by StorageFactory::create when the RAM backend is selected
+     */
+    static std::shared_ptr<RamFs> global();
+};
+
+class RamFile : public astra::IFile
+{
+public:
+    RamFile(std::shared_ptr<RamFileData> data, bool readable, bool writable, bool append);
+    RamFile();  // Not open, like MockFile when fopen fails
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    bool flush() override;
+
+    int read() override;
+    int readBytes(uint8_t *buffer, size_t length) override;
+    int available() override;
+
+    bool seek(uint32_t pos) override;
+    uint32_t position() override;
+    uint32_t size() override;
+    bool close() override;
+
+    bool isOpen() const override;
+
+private:
+    std::shared_ptr<RamFileData> _data;
+    size_t _pos = 0;
+    bool _readable = false;
+    bool _writable = false;
+    bool _append = false;
+};
+
+/**
+ * RamStorage: IStorage backed entirely by memory
+ *
+ * Logging tests using it never touch the disk and cannot collide with each
+ * other. Each default-constructed instance has its own empty filesystem;
+ * StorageFactory::create hands out instances sharing RamFs::global(), so
+ * storages created separately for writing and reading see the same files.
+ */
+class RamStorage : public astra::IStorage
+{
+public:
+    RamStorage();
+    explicit RamStorage(std::shared_ptr<RamFs> fs);
+
+    bool begin() override;
+    bool end() override;
+    bool ok() const override;
+
+    astra::IFile *openRead(const char *filename) override;
+    astra::IFile *openWrite(const char *filename, bool append = true) override;
+
+    bool exists(const char *filename) override;
+    bool remove(const char *filename) override;
+    bool mkdir(const char *path) override;   // Creates missing parents
+    bool rmdir(const char *path) override;   // Directory must be empty
+
+    /**
+     * Names of the entries directly inside a directory, sorted
+     */
+    std::vector<std::string> list(const char *path);
+
+    /**
+     * Total bytes held by all files
+     */
+    size_t usedBytes();
+
+    /**
+     * Remove every file and directory
+     */
+    void clear();
+
+    /**
+     * Write the whole tree to a directory on disk (created if missing)
+     * @return true if every file was written
+     */
+    bool snapshot(const char *hostDir);
+
+    std::shared_ptr<RamFs> filesystem() const { return fs; }
+
+private:
+    std::shared_ptr<RamFs> fs;
+};
+
+#endif // RAM_STORAGE_H
@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <RecordData/Logging/LoggingBackend/ILogSink.h>
+#include "IoStats.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * RingLogSink: ILogSink writing into a fixed-size memory-mapped ring file
+ *
+ * The file is a 4 KB header followed by `capacity` data bytes used as a
+ * circular buffer, so disk usage never grows however long a soak test runs;
+ * once full, each write overwrites the oldest bytes. A write is a memcpy
+ * into the shared mapping and an update of the header's head offset, with
+ * no stream buffering, so the newest `capacity` bytes survive the process
+ * being killed (even by SIGKILL): the kernel owns the dirty pages.
+ *
+ * head and tail are logical byte counts since the ring was created; the
+ * live data is [tail, head), stored at offset % capacity. tail is moved
+ * past the bytes a write is about to overwrite before the memcpy, and head
+ * only after it, so a reader never sees a half-written record.
+ *
+ * Writers may call write() concurrently: space is reserved with one
+ * fetch_add, copies run in parallel, and head is published in reservation
+ * order. Opening an existing ring with the same capacity continues it.
+ */
+class RingLogSink : public astra::ILogSink
+{
+public:
+    static constexpr size_t HEADER_SIZE = 4096;  // Keeps the data page-aligned
+    static constexpr char MAGIC[8] = {'N', 'R', 'I', 'N', 'G', '1', '\r', '\n'};
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint64_t capacity;
+        std::atomic<uint64_t> head;  // End of the published data
+        std::atomic<uint64_t> tail;  // Start of the data not yet overwritten
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring offsets must be lock-free in shared memory");
+
+    std::string path_;
+    uint64_t capacity_;
+    uint8_t *map_ = nullptr;
+    Header *header_ = nullptr;
+    uint8_t *data_ = nullptr;
+    std::atomic<uint64_t> reserved_{0};  // End of the space handed out to writers
+    std::shared_ptr<IoStats> stats_;
+
+public:
+    /**
+     * @param path Ring file, created (or resized and reset) by begin()
+     * @param capacity Data bytes kept, i.e. how much of the log survives
+     */
+    RingLogSink(std::string path, uint64_t capacity) : path_(std::move(path)), capacity_(capacity) {}
+    ~RingLogSink() { end(); }
+
+    RingLogSink(const RingLogSink &) = delete;
+    RingLogSink &operator=(const RingLogSink &) = delete;
+
+    bool begin() override
+    {
+        end();
+        if (capacity_ == 0)
+            return false;
+#ifdef _WIN32
+        fprintf(stderr, "RingLogSink: memory-mapped rings are not supported on Windows\n");
+        return false;
+#else
+        int fd = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            perror("RingLogSink: open");
+            return false;
+        }
+        uint64_t fileSize = HEADER_SIZE + capacity_;
+        struct stat st;
+        bool resume = fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) == fileSize;
+        if (!resume && ftruncate(fd, static_cast<off_t>(fileSize)) != 0)
+        {
+            perror("RingLogSink: ftruncate");
+            ::close(fd);
+            return false;
+        }
+        void *addr = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+        {
+            perror("RingLogSink: mmap");
+            return false;
+        }
+        map_ = static_cast<uint8_t *>(addr);
+        header_ = reinterpret_cast<Header *>(map_);
+        data_ = map_ + HEADER_SIZE;
+        if (!resume || memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0 || header_->capacity != capacity_)
+        {
+            // New file, or one from another capacity: start an empty ring
+            new (&header_->head) std::atomic<uint64_t>(0);
+            new (&header_->tail) std::atomic<uint64_t>(0);
+            header_->capacity = capacity_;
+            memcpy(header_->magic, MAGIC, sizeof(MAGIC));
+        }
+        else
+        {
+            // A writer killed between moving tail and publishing head can leave
+            // tail past head; keep the newest capacity bytes, as read() does
+            header_->tail.store(liveTail(header_->head.load(), header_->tail.load(), capacity_));
+        }
+        reserved_.store(header_->head.load());
+        stats_ = IoStats::forPath(path_);
+        return true;
+#endif
+    }
+
+    bool end() override
+    {
+#ifndef _WIN32
+        if (map_)
+            munmap(map_, HEADER_SIZE + capacity_);
+#endif
+        map_ = nullptr;
+        header_ = nullptr;
+        data_ = nullptr;
+        return true;
+    }
+
+    bool ok() const override { return map_ != nullptr; }
+
+    bool wantsPrefix() const override { return false; }
+
+    // Nothing is buffered: written bytes are already in the shared mapping
+    void flush() override {}
+
+    size_t write(uint8_t b) override
+    {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t *buf, size_t n) override
+    {
+        if (!map_ || n == 0)
+            return 0;
+        uint64_t start = reserved_.fetch_add(n, std::memory_order_relaxed);
+        uint64_t end = start + n;
+        if (end > capacity_)
+            advanceTail(end - capacity_);
+        // Only the newest capacity bytes of an oversized write can be kept
+        uint64_t skip = n > capacity_ ? n - capacity_ : 0;
+        copyIn(start + skip, buf + skip, static_cast<size_t>(n - skip));
+        // Publish in reservation order, so head never covers an unfinished copy
+        while (header_->head.load(std::memory_order_acquire) != start)
+            std::this_thread::yield();
+        header_->head.store(end, std::memory_order_release);
+        stats_->recordWrite(n);
+        return n;
+    }
+
+    using Print::write; // keep other Print overloads visible
+
+    /**
+     * Force the mapped pages to disk (only needed to survive power loss)
+     */
+    bool sync()
+    {
+#ifndef _WIN32
+        return map_ && msync(map_, HEADER_SIZE + capacity_, MS_SYNC) == 0;
+#else
+        return false;
+#endif
+    }
+
+    uint64_t capacity() const { return capacity_; }
+
+    // Bytes written over the ring's lifetime, including overwritten ones
+    uint64_t totalWritten() const { return header_ ? header_->head.load() : 0; }
+
+    /**
+     * The live data, oldest first
+     */
+    std::vector<uint8_t> contents() const
+    {
+        std::vector<uint8_t> out;
+        if (header_)
+            copyLive(header_, data_, capacity_, out);
+        return out;
+    }
+
+    // I/O counters for this ring's path (see IoStats.h), nullptr before begin()
+    IoStats *stats() const { return stats_.get(); }
+
+    /**
+     * Read the live data of a ring file, e.g. after the process that wrote it
+     * was killed
+     * @param wholeLines Once the ring has wrapped, drop the partial first line
+     * @return false if the file is not a ring
+     */
+    static bool read(const std::string &path, std::vector<uint8_t> &out, bool wholeLines = false)
+    {
+        out.clear();
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        std::vector<uint8_t> file;
+        uint8_t chunk[65536];
+        size_t got;
+        while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0)
+            file.insert(file.end(), chunk, chunk + got);
+        fclose(f);
+        if (file.size() < HEADER_SIZE || memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0)
+            return false;
+        const Header *header = reinterpret_cast<const Header *>(file.data());
+        if (file.size() != HEADER_SIZE + header->capacity || header->capacity == 0)
+            return false;
+        copyLive(header, file.data() + HEADER_SIZE, header->capacity, out);
+        if (wholeLines && header->tail.load() > 0)
+        {
+            auto newline = std::find(out.begin(), out.end(), '\n');
+            out.erase(out.begin(), newline == out.end() ? out.end() : newline + 1);
+        }
+        return true;
+    }
+
+private:
+    // Raise tail to at least target (concurrent writers may race to do it)
+    void advanceTail(uint64_t target)
+    {
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        while (tail < target && !header_->tail.compare_exchange_weak(tail, target, std::memory_order_release,
+                                                                      std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void copyIn(uint64_t logical, const uint8_t *buf, size_t n)
+    {
+        size_t at = static_cast<size_t>(logical % capacity_);
+        size_t first = std::min(n, static_cast<size_t>(capacity_) - at);
+        memcpy(data_ + at, buf, first);
+        memcpy(data_, buf + first, n - first);
+    }
+
+    // tail to use with head, if the stored one is out of range
+    static uint64_t liveTail(uint64_t head, uint64_t tail, uint64_t capacity)
+    {
+        if (head - tail > capacity || tail > head)
+            return head > capacity ? head - capacity : 0;
+        return tail;
+    }
+
+    static void copyLive(const Header *header, const uint8_t *data, uint64_t capacity, std::vector<uint8_t> &out)
+    {
+        uint64_t head = header->head.load(std::memory_order_acquire);
+        uint64_t tail = liveTail(head, header->tail.load(std::memory_order_acquire), capacity);
+        size_t n = static_cast<size_t>(head - tail);
+        size_t at = static_cast<size_t>(tail % capacity);
+        size_t first = std::min(n, static_cast<size_t>(capacity) - at);
+        out.assign(data + at, data + at + first);
+        out.insert(out.end(), data, data + (n - first));
+        // Drop whatever a concurrent writer overwrote while we copied
+        uint64_t overwritten = header->tail.load(std::memory_order_acquire) - tail;
+        if (overwritten > 0 && overwritten < capacity)
+            out.erase(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(std::min<uint64_t>(overwritten, out.size())));
+    }
+};
@@ -1,7 +1,9 @@
 #include "SITLSocket.h"
+#include "NativeRuntime.h"
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <iterator>
 #include <thread>
 
 // Platform-specific includes
@@ -58,7 +60,8 @@ void SITLSocket::cleanupSockets()
 }
 
 SITLSocket::SITLSocket()
-    : socketFd(INVALID_SOCKET_VALUE), connected(false)
+    : socketFd(INVALID_SOCKET_VALUE), connected(false), transport(TCP),
+      txSequence(0), rxSequence(0), rxSequenceValid(false), dropped(0)
 {
     initializeSockets();
 }
@@ -68,7 +71,7 @@ SITLSocket::~SITLSocket()
     disconnect();
 }
 
-bool SITLSocket::connect(const char *host, int port)
+bool SITLSocket::connect(const char *host, int port, Transport transport)
 {
     if (connected)
     {
@@ -80,6 +83,12 @@ bool SITLSocket::connect(const char *host, int port)
         return false;
     }
 
+    this->transport = transport;
+    if (transport == UDP)
+    {
+        return connectUDP(host, port);
+    }
+
     // Create socket
     socketFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (socketFd == INVALID_SOCKET_VALUE)
@@ -169,16 +178,94 @@ bool SITLSocket::connect(const char *host, int port)
     return true;
 }
 
+bool SITLSocket::connectUDP(const char *host, int port)
+{
+    socketFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socketFd == INVALID_SOCKET_VALUE)
+    {
+        fprintf(stderr, "SITL: Failed to create UDP socket: %d\n", SOCKET_ERROR_CODE);
+        return false;
+    }
+
+    struct hostent *server = gethostbyname(host);
+    if (server == nullptr)
+    {
+        fprintf(stderr, "SITL: Failed to resolve host '%s': %d\n", host, SOCKET_ERROR_CODE);
+        CLOSE_SOCKET(socketFd);
+        socketFd = INVALID_SOCKET_VALUE;
+        return false;
+    }
+
+    struct sockaddr_in serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    memcpy(&serverAddr.sin_addr.s_addr, server->h_addr, server->h_length);
+    serverAddr.sin_port = htons(port);
+
+    // A connected UDP socket only receives from the simulator and lets us use send/recv
+    if (::connect(socketFd, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR)
+    {
+        fprintf(stderr, "SITL: Failed to connect UDP socket: %d\n", SOCKET_ERROR_CODE);
+        CLOSE_SOCKET(socketFd);
+        socketFd = INVALID_SOCKET_VALUE;
+        return false;
+    }
+
+    // Keep the kernel queue short: anything older than a few frames is stale anyway
+    int rcvbuf = 64 * 1024;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, (const char *)&rcvbuf, sizeof(rcvbuf));
+
+#ifdef _WIN32
+    u_long mode = 1; // Non-blocking
+    if (ioctlsocket(socketFd, FIONBIO, &mode) != 0) {
+        fprintf(stderr, "SITL: Failed to set non-blocking mode: %d\n", SOCKET_ERROR_CODE);
+        CLOSE_SOCKET(socketFd);
+        socketFd = INVALID_SOCKET_VALUE;
+        return false;
+    }
+#else
+    int flags = fcntl(socketFd, F_GETFL, 0);
+    if (flags == -1 || fcntl(socketFd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        fprintf(stderr, "SITL: Failed to set non-blocking mode: %d\n", SOCKET_ERROR_CODE);
+        CLOSE_SOCKET(socketFd);
+        socketFd = INVALID_SOCKET_VALUE;
+        return false;
+    }
+#endif
+
+    txSequence = 0;
+    rxSequenceValid = false;
+    dropped = 0;
+    txFrame.clear();
+    txQueue.clear();
+    rxPending.clear();
+    connected = true;
+
+    // Empty hello datagram so the simulator learns our address
+    queueTxFrame();
+    sendQueued();
+
+    printf("SITL: Connected to %s:%d (UDP)\n", host, port);
+    return true;
+}
+
 void SITLSocket::disconnect()
 {
+    if (connected && transport == UDP) {
+        flush();
+    }
+    bool wasConnected = connected;
     if (socketFd != INVALID_SOCKET_VALUE) {
         CLOSE_SOCKET(socketFd);
         socketFd = INVALID_SOCKET_VALUE;
     }
+    connected = false;
 #ifndef PIO_UNIT_TESTING
-    std::exit(0);
+    // Losing the simulator ends the run; the main loop shuts down cleanly
+    if (wasConnected) {
+        requestNativeShutdown("sitl_disconnected");
+    }
 #endif
-    connected = false;
 }
 
 bool SITLSocket::isConnected() const
@@ -192,6 +279,20 @@ int SITLSocket::write(const uint8_t* data, size_t len)
         return -1;
     }
 
+    if (transport == UDP) {
+        for (size_t i = 0; i < len; i++) {
+            txFrame.push_back(data[i]);
+            if (data[i] == '\n' || txFrame.size() >= UDP_MAX_PAYLOAD) {
+                queueTxFrame();
+            }
+        }
+        // All lines completed by this call go out in one batch
+        if (!txQueue.empty() && !sendQueued()) {
+            return -1;
+        }
+        return (int)len;
+    }
+
     int totalSent = 0;
     while (totalSent < (int)len) {
         int sent = send(socketFd, (const char*)(data + totalSent), len - totalSent, 0);
@@ -224,6 +325,27 @@ int SITLSocket::read(uint8_t* buffer, size_t maxLen)
         return -1;
     }
 
+    if (transport == UDP) {
+        if (!pollDatagrams()) {
+            return -1;
+        }
+        size_t count = 0;
+        while (count < maxLen && !rxPending.empty()) {
+            RxSegment &seg = rxPending.front();
+            size_t n = seg.data.size() - seg.offset;
+            if (n > maxLen - count) {
+                n = maxLen - count;
+            }
+            memcpy(buffer + count, seg.data.data() + seg.offset, n);
+            seg.offset += n;
+            count += n;
+            if (seg.offset == seg.data.size()) {
+                rxPending.pop_front();
+            }
+        }
+        return (int)count;
+    }
+
     int received = recv(socketFd, (char*)buffer, maxLen, 0);
 
     if (received == SOCKET_ERROR) {
@@ -246,9 +368,6 @@ int SITLSocket::read(uint8_t* buffer, size_t maxLen)
         // Connection closed by peer
         fprintf(stderr, "SITL: Connection closed by simulator\n");
         disconnect();
-#ifndef PIO_UNIT_TESTING
-        std::exit(0);
-#endif
         return -1;
     }
 
@@ -261,6 +380,11 @@ int SITLSocket::available()
         return 0;
     }
 
+    if (transport == UDP) {
+        pollDatagrams();
+        return (int)rxPendingBytes();
+    }
+
 #ifdef _WIN32
     u_long bytesAvailable = 0;
     if (ioctlsocket(socketFd, FIONREAD, &bytesAvailable) == 0) {
@@ -275,3 +399,213 @@ int SITLSocket::available()
 
     return 0;
 }
+
+void SITLSocket::flush()
+{
+    if (!connected || transport != UDP) {
+        return;
+    }
+    if (!txFrame.empty()) {
+        queueTxFrame();
+    }
+    if (!txQueue.empty()) {
+        sendQueued();
+    }
+}
+
+void SITLSocket::queueTxFrame()
+{
+    std::vector<uint8_t> datagram(UDP_HEADER_SIZE + txFrame.size());
+    uint32_t seq = txSequence++;
+    datagram[0] = (uint8_t)(seq >> 24);
+    datagram[1] = (uint8_t)(seq >> 16);
+    datagram[2] = (uint8_t)(seq >> 8);
+    datagram[3] = (uint8_t)seq;
+    datagram[4] = 0;  // Stream bytes
+    datagram[5] = 0;
+    datagram[6] = (uint8_t)(txFrame.size() >> 8);
+    datagram[7] = (uint8_t)txFrame.size();
+    if (!txFrame.empty()) {
+        memcpy(datagram.data() + UDP_HEADER_SIZE, txFrame.data(), txFrame.size());
+    }
+    txQueue.push_back(std::move(datagram));
+    txFrame.clear();
+}
+
+bool SITLSocket::sendQueued()
+{
+    size_t next = 0;
+    while (next < txQueue.size()) {
+#ifdef __linux__
+        struct mmsghdr msgs[UDP_BATCH];
+        struct iovec iovs[UDP_BATCH];
+        int batch = 0;
+        while (batch < UDP_BATCH && next + batch < txQueue.size()) {
+            std::vector<uint8_t> &dg = txQueue[next + batch];
+            iovs[batch].iov_base = dg.data();
+            iovs[batch].iov_len = dg.size();
+            memset(&msgs[batch], 0, sizeof(msgs[batch]));
+            msgs[batch].msg_hdr.msg_iov = &iovs[batch];
+            msgs[batch].msg_hdr.msg_iovlen = 1;
+            batch++;
+        }
+        int sent = sendmmsg(socketFd, msgs, batch, 0);
+#else
+        const std::vector<uint8_t> &dg = txQueue[next];
+        int sent = send(socketFd, (const char *)dg.data(), (int)dg.size(), 0) == SOCKET_ERROR ? -1 : 1;
+#endif
+        if (sent < 0) {
+#ifdef _WIN32
+            int err = WSAGetLastError();
+            bool transient = (err == WSAEWOULDBLOCK || err == WSAECONNRESET);
+#else
+            int err = errno;
+            bool transient = (err == EAGAIN || err == EWOULDBLOCK || err == ECONNREFUSED || err == ENOBUFS);
+#endif
+            if (transient) {
+                // Socket buffer full or simulator not listening yet: drop rather than stall the loop
+                break;
+            }
+            fprintf(stderr, "SITL: UDP send error: %d\n", err);
+            txQueue.clear();
+            return false;
+        }
+        next += sent;
+    }
+    txQueue.clear();
+    return true;
+}
+
+bool SITLSocket::pollDatagrams()
+{
+    static const size_t DATAGRAM_MAX = 2048;  // Larger datagrams are truncated and dropped
+
+    // Drain everything the kernel holds so stale state frames never queue up behind new ones
+    while (true) {
+#ifdef __linux__
+        static thread_local std::vector<uint8_t> storage(UDP_BATCH * DATAGRAM_MAX);
+        struct mmsghdr msgs[UDP_BATCH];
+        struct iovec iovs[UDP_BATCH];
+        for (int i = 0; i < UDP_BATCH; i++) {
+            iovs[i].iov_base = storage.data() + i * DATAGRAM_MAX;
+            iovs[i].iov_len = DATAGRAM_MAX;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int received = recvmmsg(socketFd, msgs, UDP_BATCH, MSG_DONTWAIT, nullptr);
+        if (received > 0) {
+            for (int i = 0; i < received; i++) {
+                acceptDatagram((const uint8_t *)iovs[i].iov_base, msgs[i].msg_len);
+            }
+            if (received < UDP_BATCH) {
+                return true;
+            }
+            continue;
+        }
+#else
+        static thread_local std::vector<uint8_t> storage(DATAGRAM_MAX);
+        int received = recv(socketFd, (char *)storage.data(), (int)storage.size(), 0);
+        if (received > 0) {
+            acceptDatagram(storage.data(), (size_t)received);
+            continue;
+        }
+#endif
+        if (received == 0) {
+            continue;  // Empty datagram
+        }
+#ifdef _WIN32
+        int err = WSAGetLastError();
+        bool transient = (err == WSAEWOULDBLOCK || err == WSAECONNRESET || err == WSAEMSGSIZE);
+#else
+        int err = errno;
+        bool transient = (err == EAGAIN || err == EWOULDBLOCK || err == ECONNREFUSED || err == EINTR);
+#endif
+        if (transient) {
+            return true;
+        }
+        fprintf(stderr, "SITL: UDP receive error: %d\n", err);
+        disconnect();
+        return false;
+    }
+}
+
+void SITLSocket::acceptDatagram(const uint8_t* data, size_t len)
+{
+    if (len < UDP_HEADER_SIZE) {
+        dropped++;
+        return;
+    }
+    uint32_t seq = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+                   ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+    uint8_t kind = data[4];
+    uint8_t channel = data[5];
+    size_t length = ((size_t)data[6] << 8) | data[7];
+    if (length > len - UDP_HEADER_SIZE) {
+        dropped++;
+        return;
+    }
+
+    // Serial-number comparison tolerates wraparound. A sequence far behind
+    // the newest one, or an empty hello, means the simulator restarted:
+    // follow its new numbering instead of discarding everything it sends.
+    int32_t age = rxSequenceValid ? (int32_t)(seq - rxSequence) : 1;
+    bool restarted = length == 0 || age < -RX_RESYNC_GAP;
+    bool newest = age > 0 || restarted;
+    if (newest) {
+        rxSequence = seq;
+        rxSequenceValid = true;
+    }
+
+    if (length == 0) {
+        return;
+    }
+
+    const uint8_t *payload = data + UDP_HEADER_SIZE;
+    RxSegment seg;
+    seg.channel = (kind == 1) ? channel : -1;
+    seg.sequence = seq;
+    seg.data.assign(payload, payload + length);
+    seg.offset = 0;
+
+    if (kind == 1) {
+        // An older state frame than one already seen is stale
+        if (!newest) {
+            dropped++;
+            return;
+        }
+        // Latest value wins: discard an undelivered frame for the same channel
+        for (auto it = rxPending.begin(); it != rxPending.end(); ++it) {
+            if (it->channel == channel && it->offset == 0) {
+                rxPending.erase(it);
+                dropped++;
+                break;
+            }
+        }
+        rxPending.push_back(std::move(seg));
+        return;
+    }
+
+    // Stream bytes are never dropped: a late datagram goes in front of the
+    // undelivered ones sent after it, so lines stay whole and in order
+    auto at = rxPending.end();
+    if (!newest) {
+        while (at != rxPending.begin()) {
+            auto prev = std::prev(at);
+            if (prev->channel != -1 || prev->offset != 0 || (int32_t)(prev->sequence - seq) < 0) {
+                break;
+            }
+            at = prev;
+        }
+    }
+    rxPending.insert(at, std::move(seg));
+}
+
+size_t SITLSocket::rxPendingBytes() const
+{
+    size_t total = 0;
+    for (const RxSegment &seg : rxPending) {
+        total += seg.data.size() - seg.offset;
+    }
+    return total;
+}
@@ -3,18 +3,38 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <deque>
+#include <vector>
 
 /**
- * SITLSocket: Cross-platform TCP socket wrapper for Software-In-The-Loop simulation
+ * SITLSocket: Cross-platform TCP/UDP socket wrapper for Software-In-The-Loop simulation
  *
- * Provides a simple interface for connecting to an external simulator via TCP.
- * The flight software acts as a TCP client, connecting to a simulator server.
+ * Provides a simple interface for connecting to an external simulator via TCP
+ * or UDP. The flight software acts as the client, connecting to a simulator server.
  *
  * Thread-safe buffered I/O with non-blocking reads.
+ *
+ * UDP mode carries the byte stream in datagrams, each prefixed by an 8-byte
+ * header (all fields big-endian):
+ *   uint32 sequence   incremented per datagram by the sender
+ *   uint8  kind       0 = stream bytes, 1 = state frame
+ *   uint8  channel    state slot (ignored for stream bytes)
+ *   uint16 length     payload bytes following the header
+ * State frames older than the newest datagram seen are dropped, and only
+ * the newest undelivered frame per channel is kept, so a busy host reads the
+ * current sensor state instead of working through a backlog. Stream bytes
+ * are never dropped; a late stream datagram is put back in sequence among
+ * those not yet read. An empty datagram (hello) or a sequence more than
+ * 2^16 behind the newest resets the numbering, so a restarted simulator is
+ * followed instead of ignored.
+ * Outgoing bytes are packed into one datagram per line. Incoming datagrams
+ * larger than 2 KiB are dropped.
  */
 class SITLSocket
 {
 public:
+    enum Transport { TCP, UDP };
+
     SITLSocket();
     ~SITLSocket();
 
@@ -22,9 +42,10 @@ public:
      * Connect to SITL simulator server
      * @param host Hostname or IP address (e.g., "localhost" or "127.0.0.1")
      * @param port Port number (e.g., 5555)
+     * @param transport TCP stream or UDP datagrams
      * @return true if connection successful
      */
-    bool connect(const char* host, int port);
+    bool connect(const char* host, int port, Transport transport = TCP);
 
     /**
      * Disconnect from simulator
@@ -58,6 +79,16 @@ public:
      */
     int available();
 
+    /**
+     * Send any partially filled outgoing datagram (UDP only)
+     */
+    void flush();
+
+    /**
+     * Number of incoming datagrams dropped as stale or superseded (UDP only)
+     */
+    uint64_t droppedFrames() const { return dropped; }
+
 private:
 #ifdef _WIN32
     typedef unsigned long long SOCKET_TYPE;
@@ -69,6 +100,36 @@ private:
 
     SOCKET_TYPE socketFd;  // Socket file descriptor
     bool connected;
+    Transport transport;
+
+    // UDP framing state
+    static const size_t UDP_HEADER_SIZE = 8;
+    static const size_t UDP_MAX_PAYLOAD = 1200;
+    static const int UDP_BATCH = 32;
+
+    static const int32_t RX_RESYNC_GAP = 1 << 16;  // Further behind than this: peer restarted
+
+    struct RxSegment {
+        int channel;  // -1 for stream bytes
+        uint32_t sequence;
+        std::vector<uint8_t> data;
+        size_t offset;
+    };
+
+    uint32_t txSequence;
+    uint32_t rxSequence;
+    bool rxSequenceValid;
+    uint64_t dropped;
+    std::vector<uint8_t> txFrame;                  // Payload being built
+    std::vector<std::vector<uint8_t>> txQueue;     // Complete datagrams awaiting send
+    std::deque<RxSegment> rxPending;               // Received but not yet read
+
+    bool connectUDP(const char* host, int port);
+    void queueTxFrame();
+    bool sendQueued();
+    bool pollDatagrams();
+    void acceptDatagram(const uint8_t* data, size_t len);
+    size_t rxPendingBytes() const;
 
     // Platform-specific initialization (Winsock on Windows)
     static bool initializeSockets();
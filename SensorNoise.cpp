@@ -0,0 +1,292 @@
+#include "SensorNoise.h"
+#include "Arduino.h"
+#include "NativeRuntime.h"
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <vector>
+
+static uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline double toUniform(uint64_t x) {
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0);  // 2^-53
+}
+
+// Xoshiro256 implementation
+Xoshiro256::Xoshiro256(uint64_t seed) {
+    this->seed(seed);
+}
+
+void Xoshiro256::seed(uint64_t seed) {
+    uint64_t sm = seed;
+    uint64_t s[4];
+    for (int w = 0; w < 4; w++) s[w] = splitmix64(sm);
+    // Each lane starts where the previous one jumped 2^128 steps ahead
+    static const uint64_t JUMP[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                     0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+    for (int lane = 0; lane < LANES; lane++) {
+        for (int w = 0; w < 4; w++) _s[w][lane] = s[w];
+        uint64_t j[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 4; i++) {
+            for (int b = 0; b < 64; b++) {
+                if (JUMP[i] & (1ULL << b)) {
+                    for (int w = 0; w < 4; w++) j[w] ^= s[w];
+                }
+                uint64_t t = s[1] << 17;
+                s[2] ^= s[0];
+                s[3] ^= s[1];
+                s[1] ^= s[2];
+                s[0] ^= s[3];
+                s[2] ^= t;
+                s[3] = rotl(s[3], 45);
+            }
+        }
+        for (int w = 0; w < 4; w++) s[w] = j[w];
+    }
+    _cacheUsed = LANES;
+    _hasSpare = false;
+}
+
+// Advance all lanes `steps` times, writing LANES outputs per step. The state
+// is worked on in locals so the compiler knows `out` cannot overlap it.
+static void stepLanes(uint64_t (&state)[4][Xoshiro256::LANES], uint64_t* out, size_t steps) {
+    const int L = Xoshiro256::LANES;
+    uint64_t s0[L], s1[L], s2[L], s3[L];
+    for (int lane = 0; lane < L; lane++) {
+        s0[lane] = state[0][lane];
+        s1[lane] = state[1][lane];
+        s2[lane] = state[2][lane];
+        s3[lane] = state[3][lane];
+    }
+    for (size_t k = 0; k < steps; k++) {
+        for (int lane = 0; lane < L; lane++) {
+            out[k * L + lane] = s0[lane] + s3[lane];
+            uint64_t t = s1[lane] << 17;
+            s2[lane] ^= s0[lane];
+            s3[lane] ^= s1[lane];
+            s1[lane] ^= s2[lane];
+            s0[lane] ^= s3[lane];
+            s2[lane] ^= t;
+            s3[lane] = rotl(s3[lane], 45);
+        }
+    }
+    for (int lane = 0; lane < L; lane++) {
+        state[0][lane] = s0[lane];
+        state[1][lane] = s1[lane];
+        state[2][lane] = s2[lane];
+        state[3][lane] = s3[lane];
+    }
+}
+
+uint64_t Xoshiro256::next() {
+    if (_cacheUsed == LANES) {
+        stepLanes(_s, _cache, 1);
+        _cacheUsed = 0;
+    }
+    return _cache[_cacheUsed++];
+}
+
+void Xoshiro256::fill(uint64_t* out, size_t n) {
+    size_t k = 0;
+    while (k < n && _cacheUsed < LANES) out[k++] = _cache[_cacheUsed++];
+    // Whole steps straight into the output
+    size_t steps = (n - k) / LANES;
+    stepLanes(_s, out + k, steps);
+    k += steps * LANES;
+    while (k < n) out[k++] = next();
+}
+
+double Xoshiro256::uniform() {
+    return toUniform(next());
+}
+
+void Xoshiro256::fillUniform(double* out, size_t n) {
+    uint64_t raw[256];
+    for (size_t k = 0; k < n; k += 256) {
+        size_t chunk = n - k < 256 ? n - k : 256;
+        fill(raw, chunk);
+        for (size_t i = 0; i < chunk; i++) out[k + i] = toUniform(raw[i]);
+    }
+}
+
+// Marsaglia's polar method: one log and one sqrt per pair of values, no
+// trigonometry. Returns false (nothing written) for a rejected pair.
+static inline bool polarPair(double u, double v, double* out) {
+    u = 2.0 * u - 1.0;
+    v = 2.0 * v - 1.0;
+    double s = u * u + v * v;
+    if (s >= 1.0 || s == 0.0) return false;
+    double f = sqrt(-2.0 * log(s) / s);
+    out[0] = u * f;
+    out[1] = v * f;
+    return true;
+}
+
+double Xoshiro256::gaussian() {
+    if (_hasSpare) {
+        _hasSpare = false;
+        return _spare;
+    }
+    double pair[2];
+    for (;;) {
+        double u = uniform();  // Sequenced: argument order is unspecified
+        double v = uniform();
+        if (polarPair(u, v, pair)) break;
+    }
+    _spare = pair[1];
+    _hasSpare = true;
+    return pair[0];
+}
+
+void Xoshiro256::fillGaussian(double* out, size_t n) {
+    size_t k = 0;
+    if (n > 0 && _hasSpare) {
+        out[k++] = _spare;
+        _hasSpare = false;
+    }
+    // Uniforms in batches of at most the pairs still needed, so exactly the
+    // values gaussian() would have drawn are consumed, in the same order
+    double uniforms[256];
+    while (n - k >= 2) {
+        size_t pairs = (n - k) / 2;
+        if (pairs > 128) pairs = 128;
+        fillUniform(uniforms, pairs * 2);
+        for (size_t i = 0; i < pairs; i++) {
+            if (polarPair(uniforms[2 * i], uniforms[2 * i + 1], out + k)) k += 2;
+        }
+    }
+    if (k < n) out[k] = gaussian();
+}
+
+// SensorNoise implementation
+SensorNoise::SensorNoise(const NoiseParams& params, uint64_t seed) {
+    configure(params, seed);
+}
+
+void SensorNoise::configure(const NoiseParams& params, uint64_t seed) {
+    _params = params;
+    _enabled = params.whiteNoise != 0 || params.bias != 0 || params.biasInstability != 0 ||
+               params.randomWalk != 0 || params.scaleFactor != 0 || params.quantization != 0;
+    _random.seed(seed);
+    for (int a = 0; a < MAX_AXES; a++) {
+        _markov[a] = 0;
+        _walk[a] = 0;
+    }
+    _started = false;
+    _stepDt = 0;
+    _buffered = 0;
+}
+
+double SensorNoise::gaussian() {
+    if (_buffered == 0) {
+        _random.fillGaussian(_buffer, BUFFER_SIZE);
+        _buffered = BUFFER_SIZE;
+    }
+    return _buffer[BUFFER_SIZE - _buffered--];
+}
+
+void SensorNoise::apply(double* values, int axes, uint64_t nowMicros) {
+    if (!_enabled) return;
+    if (axes > MAX_AXES) axes = MAX_AXES;
+    const NoiseParams& p = _params;
+
+    double dt = 0;
+    if (!_started) {
+        // Turn-on bias: start the Gauss-Markov process in its steady state
+        if (p.biasInstability != 0) {
+            for (int a = 0; a < axes; a++) _markov[a] = p.biasInstability * gaussian();
+        }
+        _started = true;
+    } else if (nowMicros > _lastMicros) {
+        dt = (double)(nowMicros - _lastMicros) * 1e-6;
+    }
+    _lastMicros = nowMicros;
+
+    if (dt > 0 && dt != _stepDt) {
+        // Sensors are usually read at a fixed rate, so this runs once
+        _stepDt = dt;
+        _markovPhi = p.biasCorrelationSeconds > 0 ? exp(-dt / p.biasCorrelationSeconds) : 1.0;
+        _markovSigma = p.biasInstability * sqrt(1.0 - _markovPhi * _markovPhi);
+        _walkSigma = p.randomWalk * sqrt(dt);
+    }
+    if (dt > 0 && p.biasInstability != 0) {
+        for (int a = 0; a < axes; a++) _markov[a] = _markovPhi * _markov[a] + _markovSigma * gaussian();
+    }
+    if (dt > 0 && p.randomWalk != 0) {
+        for (int a = 0; a < axes; a++) _walk[a] += _walkSigma * gaussian();
+    }
+
+    for (int a = 0; a < axes; a++) {
+        double v = (1.0 + p.scaleFactor) * values[a] + p.bias + _markov[a] + _walk[a];
+        if (p.whiteNoise != 0) v += p.whiteNoise * gaussian();
+        if (p.quantization > 0) v = std::round(v / p.quantization) * p.quantization;
+        values[a] = v;
+    }
+}
+
+void SensorNoise::apply(double* values, int axes) {
+    apply(values, axes, micros());
+}
+
+double SensorNoise::apply(double value) {
+    apply(&value, 1, micros());
+    return value;
+}
+
+double SensorNoise::currentBias(int axis) const {
+    if (axis < 0 || axis >= MAX_AXES) return 0;
+    return _params.bias + _markov[axis] + _walk[axis];
+}
+
+uint64_t SensorNoise::defaultSeed(const char* stream, int instance) {
+    // FNV-1a of the stream name, mixed into the run seed
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char* c = stream; c && *c; c++) h = (h ^ (uint8_t)*c) * 0x100000001b3ULL;
+    uint64_t state = nativeRunOptions().seed ^ h;
+    uint64_t seed = splitmix64(state);
+    // Instance 0 keeps the seed a lone sensor always had
+    for (int i = 0; i < instance; i++) seed = splitmix64(state);
+    return seed;
+}
+
+// Instance numbers in use, per stream name
+static std::mutex instancesLock;
+static std::map<std::string, std::vector<bool>>& instances() {
+    static std::map<std::string, std::vector<bool>> used;
+    return used;
+}
+
+void SensorNoise::Instance::claim() {
+    number = 0;
+    if (stream.empty()) return;
+    std::lock_guard<std::mutex> guard(instancesLock);
+    std::vector<bool>& used = instances()[stream];
+    while (number < (int)used.size() && used[number]) number++;
+    if (number == (int)used.size()) used.push_back(false);
+    used[number] = true;
+}
+
+void SensorNoise::Instance::release() {
+    if (stream.empty()) return;
+    std::lock_guard<std::mutex> guard(instancesLock);
+    std::vector<bool>& used = instances()[stream];
+    if (number < (int)used.size()) used[number] = false;
+}
+
+SensorNoise::Instance& SensorNoise::Instance::operator=(const Instance& other) {
+    if (this != &other) {
+        release();
+        stream = other.stream;
+        claim();
+    }
+    return *this;
+}
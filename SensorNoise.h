@@ -0,0 +1,173 @@
+#ifndef SENSOR_NOISE_H
+#define SENSOR_NOISE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * Xoshiro256: xoshiro256+ run as four interleaved lanes
+ *
+ * Every lane is an independent xoshiro256+ stream (the lanes start 2^128
+ * steps apart) and outputs are taken from lanes 0..3 in turn. Stepping the
+ * four lanes together is plain 64-bit add, xor and shift, which fill()
+ * leaves to the compiler to vectorise. next() and the fill functions
+ * consume the same sequence, so results only depend on the seed and the
+ * number of values drawn, never on how they were batched.
+ *
+ * xoshiro256+ is the variant meant for floating point: only the top 53
+ * bits go into a double, which avoids its weaker low bits.
+ */
+class Xoshiro256
+{
+public:
+    static const int LANES = 4;
+
+    explicit Xoshiro256(uint64_t seed = 0);
+
+    void seed(uint64_t seed);
+
+    uint64_t next();
+    double uniform();   // [0, 1)
+    double gaussian();  // Standard normal (polar method)
+
+    void fill(uint64_t* out, size_t n);
+    void fillUniform(double* out, size_t n);
+    void fillGaussian(double* out, size_t n);
+
+private:
+    uint64_t _s[4][LANES];    // State word, lane
+    uint64_t _cache[LANES];   // Outputs of the last step
+    int _cacheUsed = LANES;
+    double _spare = 0;        // Second value of the last polar-method pair
+    bool _hasSpare = false;
+};
+
+/**
+ * Error model of one sensor output; zero everywhere means a perfect sensor
+ *
+ * A sample is computed as
+ *   quantise((1 + scaleFactor) * truth + bias + markov + walk + whiteNoise * n)
+ * where markov is a first-order Gauss-Markov process (bias instability) and
+ * walk integrates white noise (bias random walk). Each axis has its own drift
+ * states; the parameters are shared by the axes of a sensor.
+ */
+struct NoiseParams
+{
+    double whiteNoise = 0;                // Standard deviation added to every sample
+    double bias = 0;                      // Constant offset
+    double biasInstability = 0;           // Standard deviation of the Gauss-Markov bias
+    double biasCorrelationSeconds = 100;  // Its correlation time
+    double randomWalk = 0;                // Bias random walk, units per sqrt(second)
+    double scaleFactor = 0;               // Gain error, 0.01 for +1 %
+    double quantization = 0;              // Output step (LSB), 0 for continuous output
+};
+
+/**
+ * SensorNoise: Deterministic noise, bias and drift for a fake sensor
+ *
+ * Used by the fakes in UnitTestSensors.h through setNoise(). Drift states
+ * advance with the time between samples on the mock clock (micros()), so
+ * the same seed and the same sequence of reads give the same samples on
+ * every run. Gaussians are generated 64 at a time into a buffer.
+ *
+ * Without an explicit seed, a sensor uses defaultSeed(), which follows
+ * --seed, so each Monte Carlo run sees different but reproducible noise.
+ * A SensorNoise constructed with a stream name also takes the lowest
+ * instance number not held by another live SensorNoise of that name, and
+ * configure() without a seed mixes it in: redundant sensors of one kind
+ * (e.g. two FakeAccels voting) get independent noise, and the seeds do not
+ * depend on how many sensors earlier tests created.
+ */
+class SensorNoise
+{
+public:
+    static const int MAX_AXES = 3;
+    static const int BUFFER_SIZE = 64;
+
+    SensorNoise() = default;
+    SensorNoise(const NoiseParams& params, uint64_t seed);
+
+    /**
+     * @param stream Name for default seeds, usually the fake's class name
+     */
+    explicit SensorNoise(const char* stream) : _instance(stream) {}
+
+    /**
+     * Set the parameters and seed, and restart the drift states
+     */
+    void configure(const NoiseParams& params, uint64_t seed);
+
+    /**
+     * configure() with instanceSeed()
+     */
+    void configure(const NoiseParams& params) { configure(params, instanceSeed()); }
+
+    /**
+     * defaultSeed() of this object's stream name and instance number
+     */
+    uint64_t instanceSeed() const { return defaultSeed(_instance.stream.c_str(), _instance.number); }
+
+    const NoiseParams& params() const { return _params; }
+    bool enabled() const { return _enabled; }
+
+    /**
+     * Turn `axes` true values into sensor samples, in place
+     * @param nowMicros Sample time; drift advances by the time since the last call
+     */
+    void apply(double* values, int axes, uint64_t nowMicros);
+
+    /**
+     * apply() at micros()
+     */
+    void apply(double* values, int axes);
+    double apply(double value);
+
+    /**
+     * Current bias of an axis (bias + markov + walk), for checking estimators
+     */
+    double currentBias(int axis) const;
+
+    /**
+     * Seed derived from the run seed (--seed) and a per-sensor stream name
+     * @param instance Distinguishes sensors sharing a stream; 0 for the first
+     */
+    static uint64_t defaultSeed(const char* stream, int instance = 0);
+
+private:
+    // Instance number held while alive; a copy takes a number of its own
+    struct Instance
+    {
+        std::string stream;
+        int number = 0;
+
+        Instance() = default;
+        explicit Instance(const char* name) : stream(name) { claim(); }
+        Instance(const Instance& other) : stream(other.stream) { claim(); }
+        Instance& operator=(const Instance& other);
+        ~Instance() { release(); }
+
+        void claim();
+        void release();
+    };
+
+    double gaussian();
+
+    Instance _instance;
+
+    NoiseParams _params;
+    bool _enabled = false;
+    Xoshiro256 _random;
+    double _markov[MAX_AXES] = {};
+    double _walk[MAX_AXES] = {};
+    uint64_t _lastMicros = 0;
+    bool _started = false;
+    double _stepDt = 0;        // Interval the factors below were computed for
+    double _markovPhi = 1;
+    double _markovSigma = 0;
+    double _walkSigma = 0;
+    double _buffer[BUFFER_SIZE];
+    int _buffered = 0;
+};
+
+#endif // SENSOR_NOISE_H
@@ -0,0 +1,206 @@
+#include "StorageDeviceModel.h"
+#include "Arduino.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static std::shared_ptr<StorageDeviceModel> environmentModel;
+
+static void reportAtExit()
+{
+    if (environmentModel) {
+        environmentModel->report(stderr);
+    }
+}
+
+StorageDeviceProfile StorageDeviceProfile::sdCard()
+{
+    StorageDeviceProfile p;
+    p.name = "sd";
+    p.pageSize = 512;
+    p.clusterSize = 32 * 1024;
+    p.writeBytesPerSecond = 2.0e6;
+    p.readBytesPerSecond = 4.0e6;
+    p.writeCallMicros = 50;
+    p.readCallMicros = 2;
+    p.clusterAllocMicros = 1500;
+    p.gcIntervalBytes = 512 * 1024;
+    p.gcStallMicros = 60000;
+    p.gcJitterMicros = 60000;
+    p.flushMicros = 2000;
+    return p;
+}
+
+StorageDeviceProfile StorageDeviceProfile::spiFlash()
+{
+    StorageDeviceProfile p;
+    p.name = "flash";
+    p.pageSize = 256;
+    p.clusterSize = 4 * 1024;
+    p.writeBytesPerSecond = 365e3;  // 0.7 ms per page program
+    p.readBytesPerSecond = 10.0e6;
+    p.writeCallMicros = 5;
+    p.readCallMicros = 1;
+    p.clusterAllocMicros = 45000;   // Sector erase
+    p.gcIntervalBytes = 0;
+    p.gcStallMicros = 0;
+    p.gcJitterMicros = 0;
+    p.flushMicros = 500;
+    return p;
+}
+
+StorageDeviceModel::StorageDeviceModel(const StorageDeviceProfile& profile, uint64_t seed)
+    : deviceProfile(profile), rngState(seed ? seed : 1)
+{
+}
+
+void StorageDeviceModel::charge(uint64_t us)
+{
+    if (us == 0) {
+        return;
+    }
+    if (fakeClockActive()) {
+        advanceMicros(us);
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+uint64_t StorageDeviceModel::programMicros(uint64_t bytes) const
+{
+    return (uint64_t)(bytes * 1e6 / deviceProfile.writeBytesPerSecond);
+}
+
+uint32_t StorageDeviceModel::nextJitter()
+{
+    if (deviceProfile.gcJitterMicros == 0) {
+        return 0;
+    }
+    // xorshift64: stall lengths are reproducible and leave random() alone
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (uint32_t)(rngState % ((uint64_t)deviceProfile.gcJitterMicros + 1));
+}
+
+uint64_t StorageDeviceModel::chargeWrite(size_t bytes)
+{
+    uint64_t cost;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const StorageDeviceProfile& p = deviceProfile;
+        cost = p.writeCallMicros;
+
+        pendingPageBytes += bytes;
+        uint64_t fullPages = pendingPageBytes / p.pageSize;
+        pendingPageBytes %= p.pageSize;
+        cost += programMicros(fullPages * p.pageSize);
+
+        uint64_t before = bytesWritten;
+        bytesWritten += bytes;
+        cost += (bytesWritten / p.clusterSize - before / p.clusterSize) * p.clusterAllocMicros;
+
+        if (p.gcIntervalBytes) {
+            bytesSinceGc += bytes;
+            while (bytesSinceGc >= p.gcIntervalBytes) {
+                bytesSinceGc -= p.gcIntervalBytes;
+                cost += p.gcStallMicros + nextJitter();
+                gcCount++;
+            }
+        }
+        writes.record(cost * 1000);
+    }
+    charge(cost);
+    return cost;
+}
+
+uint64_t StorageDeviceModel::chargeFlush()
+{
+    uint64_t cost;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        cost = deviceProfile.flushMicros;
+        if (pendingPageBytes) {
+            cost += programMicros(deviceProfile.pageSize);
+            pendingPageBytes = 0;
+        }
+        flushes.record(cost * 1000);
+    }
+    charge(cost);
+    return cost;
+}
+
+uint64_t StorageDeviceModel::chargeRead(size_t bytes)
+{
+    uint64_t cost;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        cost = deviceProfile.readCallMicros + (uint64_t)(bytes * 1e6 / deviceProfile.readBytesPerSecond);
+        reads.record(cost * 1000);
+    }
+    charge(cost);
+    return cost;
+}
+
+uint64_t StorageDeviceModel::gcStalls()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return gcCount;
+}
+
+LatencyHistogram StorageDeviceModel::writeLatencies()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return writes;
+}
+
+LatencyHistogram StorageDeviceModel::flushLatencies()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return flushes;
+}
+
+LatencyHistogram StorageDeviceModel::readLatencies()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return reads;
+}
+
+void StorageDeviceModel::report(FILE* out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    fprintf(out, "========================================\n");
+    fprintf(out, "STORAGE DEVICE (%s)\n", deviceProfile.name);
+    writes.print(out, "write()");
+    flushes.print(out, "flush()");
+    reads.print(out, "read()");
+    fprintf(out, "bytes written: %llu, gc stalls: %llu\n",
+            (unsigned long long)bytesWritten, (unsigned long long)gcCount);
+    fprintf(out, "========================================\n");
+    fflush(out);
+}
+
+std::shared_ptr<StorageDeviceModel> StorageDeviceModel::fromEnvironment()
+{
+    static bool checked = false;
+    if (checked) {
+        return environmentModel;
+    }
+    checked = true;
+
+    const char* device = getenv("NATIVE_STORAGE_DEVICE");
+    if (!device || !device[0]) {
+        return nullptr;
+    }
+    if (strcmp(device, "sd") == 0) {
+        environmentModel = std::make_shared<StorageDeviceModel>(StorageDeviceProfile::sdCard());
+    } else if (strcmp(device, "flash") == 0) {
+        environmentModel = std::make_shared<StorageDeviceModel>(StorageDeviceProfile::spiFlash());
+    } else {
+        fprintf(stderr, "NATIVE_STORAGE_DEVICE: unknown device '%s' (expected sd or flash)\n", device);
+        return nullptr;
+    }
+    atexit(reportAtExit);
+    return environmentModel;
+}
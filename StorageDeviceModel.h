@@ -0,0 +1,105 @@
+#ifndef STORAGE_DEVICE_MODEL_H
+#define STORAGE_DEVICE_MODEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include "LatencyHistogram.h"
+
+/**
+ * Timing parameters of an emulated storage device
+ */
+struct StorageDeviceProfile
+{
+    const char* name;
+    uint32_t pageSize;            // Program unit; a partial page costs a full one on flush
+    uint32_t clusterSize;         // Allocation unit; growing into a new one costs clusterAllocMicros
+    double writeBytesPerSecond;   // Sustained program bandwidth
+    double readBytesPerSecond;
+    uint32_t writeCallMicros;     // Fixed command overhead per write()
+    uint32_t readCallMicros;      // Fixed overhead per read()
+    uint32_t clusterAllocMicros;  // FAT update / block erase
+    uint64_t gcIntervalBytes;     // Garbage-collection stall every this many bytes, 0 for none
+    uint32_t gcStallMicros;       // Minimum stall
+    uint32_t gcJitterMicros;      // Extra stall, uniform in [0, gcJitterMicros]
+    uint32_t flushMicros;         // Metadata commit on flush()/close()
+
+    /**
+     * Typical class 10 microSD card behind an SPI SdFat driver:
+     * ~2 MB/s sustained with 60-120 ms stalls every 512 KiB
+     */
+    static StorageDeviceProfile sdCard();
+
+    /**
+     * Typical 128 Mbit SPI NOR flash: 256 B pages, 4 KiB sectors erased on demand
+     */
+    static StorageDeviceProfile spiFlash();
+};
+
+/**
+ * StorageDeviceModel: Latency and throughput emulation for MockStorage files
+ *
+ * Host files complete at SSD speed, which hides the stalls an SD card or
+ * flash chip puts into a logger. A model attached to MockStorage charges
+ * every MockFile write(), flush()/close() and read() the time the device
+ * would have taken: the fake clock is advanced when it is active (setMillis,
+ * setVirtualTime or a bound MockWorld), otherwise the call really sleeps.
+ *
+ * Writes are accumulated into pages, so only full pages cost bandwidth until
+ * a flush programs the partial one. One model stands for one physical
+ * device: share it between the files and storages that live on it.
+ *
+ * Every charge is recorded per call type, so buffer sizes can be chosen from
+ * the worst write latency before flying.
+ *
+ * Enabled from StorageFactory::create through an environment variable:
+ *   NATIVE_STORAGE_DEVICE=sd|flash   device profile (report printed at exit)
+ */
+class StorageDeviceModel
+{
+public:
+    explicit StorageDeviceModel(const StorageDeviceProfile& profile, uint64_t seed = 1);
+
+    // Charge one call and return its cost in microseconds
+    uint64_t chargeWrite(size_t bytes);
+    uint64_t chargeFlush();
+    uint64_t chargeRead(size_t bytes);
+
+    void report(FILE* out);
+
+    const StorageDeviceProfile& profile() const { return deviceProfile; }
+    uint64_t gcStalls();
+
+    // Charged latency per call, in ns
+    LatencyHistogram writeLatencies();
+    LatencyHistogram flushLatencies();
+    LatencyHistogram readLatencies();
+
+    /**
+     * Process-wide device selected by NATIVE_STORAGE_DEVICE
+     * @return The model, or nullptr when storage should run at host speed
+     */
+    static std::shared_ptr<StorageDeviceModel> fromEnvironment();
+
+private:
+    static void charge(uint64_t us);
+    uint64_t programMicros(uint64_t bytes) const;
+    uint32_t nextJitter();
+
+    StorageDeviceProfile deviceProfile;
+    std::mutex lock;
+    uint64_t rngState;
+
+    uint64_t bytesWritten = 0;
+    uint64_t pendingPageBytes = 0;   // Written but not yet programmed
+    uint64_t bytesSinceGc = 0;
+    uint64_t gcCount = 0;
+
+    LatencyHistogram writes;
+    LatencyHistogram flushes;
+    LatencyHistogram reads;
+};
+
+#endif // STORAGE_DEVICE_MODEL_H
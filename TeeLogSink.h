@@ -0,0 +1,326 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <RecordData/Logging/LoggingBackend/ILogSink.h>
+#include "WakeSignal.h"
+
+/**
+ * How TeeLogSink delivers to one downstream sink
+ */
+struct TeeSinkOptions
+{
+    bool queued = true;          // Deliver from a thread of its own; false calls the sink inside write()
+    size_t queueDepth = 4096;    // Records a queued sink may fall behind (rounded up to a power of two)
+    bool blockWhenFull = false;  // Wait for room instead of dropping records for this sink
+};
+
+/**
+ * TeeLogSink: ILogSink fanning every record out to several Print sinks
+ *
+ * The record is formatted once, by the Print call on the tee, and its
+ * bytes are copied once into a reference-counted buffer. Every sink
+ * receives that same buffer, e.g. a NativeFileLog, Serial and a SITL
+ * channel.
+ *
+ * Queued sinks (the default) each get a lock-free single-producer queue of
+ * buffer pointers and a delivery thread, so a slow sink only falls behind
+ * on its own. Delivery threads run every 10 ms, or as soon as 64 records
+ * are waiting. When its queue is full, records for that sink are dropped
+ * (and counted) unless blockWhenFull is set. Direct sinks are written
+ * inline, which suits fast in-memory targets.
+ *
+ * With lineBuffered (the default) writes are collected until one ends in a
+ * newline, so a println() is one record rather than two; flush() and a
+ * 4 KB limit also end a record. write() may be called from several threads;
+ * every sink sees the records in the same order.
+ *
+ * Sinks are added before begin(). flush() waits until every queued sink
+ * has written and flushed what was logged before the call.
+ */
+class TeeLogSink : public astra::ILogSink
+{
+public:
+    static constexpr size_t MAX_PENDING = 4096;
+    static constexpr uint64_t WAKE_RECORDS = 64;  // Backlog that wakes a delivery thread early
+    static constexpr int DELIVERY_PERIOD_MS = 10; // Delivery threads drain at least this often
+
+private:
+    struct Buffer
+    {
+        std::atomic<uint32_t> refs;
+        size_t length;
+        uint8_t *data() { return reinterpret_cast<uint8_t *>(this + 1); }
+    };
+
+    struct Target
+    {
+        Print *sink = nullptr;
+        int index = 0;
+        TeeSinkOptions options;
+        std::vector<Buffer *> ring;
+        uint64_t mask = 0;
+        std::atomic<uint64_t> head{0};  // Next slot the tee fills
+        std::atomic<uint64_t> tail{0};  // Next slot the delivery thread reads
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> stopping{false};
+        std::thread thread;
+        WakeSignal wake;
+        std::condition_variable flushed;
+        uint64_t flushTarget = 0;   // Guarded by wake.lock()
+        uint64_t flushedUpTo = 0;   // Guarded by wake.lock()
+    };
+
+    std::vector<std::unique_ptr<Target>> targets_;
+    size_t queuedTargets_ = 0;
+    bool lineBuffered_;
+    bool started_ = false;
+    std::mutex writeLock_;  // One record order for every sink
+    std::vector<uint8_t> pending_;
+
+public:
+    explicit TeeLogSink(bool lineBuffered = true) : lineBuffered_(lineBuffered) {}
+    ~TeeLogSink() { end(); }
+
+    TeeLogSink(const TeeLogSink &) = delete;
+    TeeLogSink &operator=(const TeeLogSink &) = delete;
+
+    /**
+     * Add a downstream sink (before begin()); the tee does not own it
+     * @return Index for dropped() and backlog()
+     */
+    int addSink(Print &sink, const TeeSinkOptions &options = TeeSinkOptions())
+    {
+        std::unique_ptr<Target> target(new Target());
+        target->sink = &sink;
+        target->index = static_cast<int>(targets_.size());
+        target->options = options;
+        if (options.queued)
+        {
+            size_t depth = 1;
+            while (depth < options.queueDepth)
+                depth <<= 1;
+            target->ring.assign(depth, nullptr);
+            target->mask = depth - 1;
+            queuedTargets_++;
+        }
+        targets_.push_back(std::move(target));
+        return static_cast<int>(targets_.size()) - 1;
+    }
+
+    bool begin() override
+    {
+        if (started_)
+            return true;
+        for (auto &target : targets_)
+        {
+            if (target->options.queued)
+            {
+                target->stopping.store(false);
+                target->thread = std::thread(&TeeLogSink::deliverLoop, target.get());
+            }
+        }
+        started_ = true;
+        return true;
+    }
+
+    bool end() override
+    {
+        if (!started_)
+            return true;
+        flush();
+        for (auto &target : targets_)
+        {
+            if (!target->thread.joinable())
+                continue;
+            target->stopping.store(true);
+            target->wake.wake();
+            target->thread.join();
+        }
+        started_ = false;
+        return true;
+    }
+
+    bool ok() const override { return started_; }
+
+    bool wantsPrefix() const override { return false; }
+
+    size_t write(uint8_t b) override
+    {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t *buf, size_t n) override
+    {
+        if (!started_ || n == 0)
+            return 0;
+        std::lock_guard<std::mutex> guard(writeLock_);
+        if (!lineBuffered_)
+        {
+            deliver(buf, n);
+            return n;
+        }
+        pending_.insert(pending_.end(), buf, buf + n);
+        if (buf[n - 1] == '\n' || pending_.size() >= MAX_PENDING)
+            deliverPending();
+        return n;
+    }
+
+    using Print::write; // keep other Print overloads visible
+
+    void flush() override
+    {
+        if (!started_)
+            return;
+        std::vector<std::pair<Target *, uint64_t>> waits;
+        {
+            std::lock_guard<std::mutex> guard(writeLock_);
+            deliverPending();
+            for (auto &target : targets_)
+            {
+                if (!target->options.queued)
+                {
+                    target->sink->flush();
+                    continue;
+                }
+                uint64_t upTo = target->head.load(std::memory_order_relaxed);
+                {
+                    std::lock_guard<std::mutex> targetGuard(target->wake.lock());
+                    target->flushTarget = std::max(target->flushTarget, upTo);
+                }
+                target->wake.wake();
+                waits.emplace_back(target.get(), upTo);
+            }
+        }
+        for (auto &wait : waits)
+        {
+            Target &target = *wait.first;
+            std::unique_lock<std::mutex> lock(target.wake.lock());
+            target.flushed.wait(lock, [&] { return target.flushedUpTo >= wait.second; });
+        }
+    }
+
+    size_t sinkCount() const { return targets_.size(); }
+
+    // Records dropped for a sink because its queue was full
+    uint64_t dropped(int sink) const { return targets_[static_cast<size_t>(sink)]->dropped.load(); }
+
+    // Records queued for a sink and not yet delivered
+    uint64_t backlog(int sink) const
+    {
+        const Target &target = *targets_[static_cast<size_t>(sink)];
+        return target.head.load() - target.tail.load();
+    }
+
+private:
+    void deliverPending()
+    {
+        if (pending_.empty())
+            return;
+        deliver(pending_.data(), pending_.size());
+        pending_.clear();
+    }
+
+    // Hand one record to every sink; called with writeLock_ held
+    void deliver(const uint8_t *data, size_t n)
+    {
+        Buffer *buffer = nullptr;
+        if (queuedTargets_)
+        {
+            buffer = new (::operator new(sizeof(Buffer) + n)) Buffer();
+            buffer->refs.store(static_cast<uint32_t>(queuedTargets_) + 1, std::memory_order_relaxed);
+            buffer->length = n;
+            memcpy(buffer->data(), data, n);
+        }
+        for (auto &target : targets_)
+        {
+            if (!target->options.queued)
+                target->sink->write(data, n);
+            else if (!push(*target, buffer))
+                release(buffer);
+        }
+        if (buffer)
+            release(buffer);
+    }
+
+    static bool push(Target &target, Buffer *buffer)
+    {
+        uint64_t head = target.head.load(std::memory_order_relaxed);
+        while (head - target.tail.load(std::memory_order_acquire) > target.mask)
+        {
+            if (!target.options.blockWhenFull)
+            {
+                if (target.dropped.fetch_add(1, std::memory_order_relaxed) == 0)
+                    fprintf(stderr, "TeeLogSink: sink %d fell %zu records behind, dropping records for it\n",
+                            target.index, target.ring.size());
+                return false;
+            }
+            target.wake.wake();
+            std::this_thread::yield();
+        }
+        target.ring[head & target.mask] = buffer;
+        target.head.store(head + 1, std::memory_order_release);
+        // A shallow ring must not fill up waiting for WAKE_RECORDS
+        uint64_t backlog = head + 1 - target.tail.load(std::memory_order_relaxed);
+        if (backlog >= std::min<uint64_t>(WAKE_RECORDS, target.ring.size() / 2))
+            target.wake.wakeIfIdle();
+        return true;
+    }
+
+    static void release(Buffer *buffer)
+    {
+        if (buffer->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            buffer->~Buffer();
+            ::operator delete(buffer);
+        }
+    }
+
+    static void deliverLoop(Target *target)
+    {
+        uint64_t tail = target->tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            uint64_t head = target->head.load(std::memory_order_acquire);
+            while (tail != head)
+            {
+                Buffer *buffer = target->ring[tail & target->mask];
+                target->sink->write(buffer->data(), buffer->length);
+                release(buffer);
+                target->tail.store(++tail, std::memory_order_release);
+            }
+            bool flushNow;
+            {
+                std::lock_guard<std::mutex> guard(target->wake.lock());
+                flushNow = target->flushTarget > target->flushedUpTo && tail >= target->flushTarget;
+            }
+            if (flushNow)
+            {
+                target->sink->flush();
+                {
+                    std::lock_guard<std::mutex> guard(target->wake.lock());
+                    target->flushedUpTo = tail;
+                }
+                target->flushed.notify_all();
+            }
+            if (tail != target->head.load(std::memory_order_acquire))
+                continue;
+            if (target->stopping.load())
+                return;
+            // Also stay up while a flush() is waiting on this sink
+            target->wake.sleep(std::chrono::milliseconds(DELIVERY_PERIOD_MS), [&] {
+                return tail == target->head.load() && !target->stopping.load() &&
+                       target->flushTarget <= target->flushedUpTo;
+            });
+        }
+    }
+};
@@ -0,0 +1,270 @@
+#include "Trajectory.h"
+#include "BinaryLog.h"
+#include "Arduino.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Where each profile column lands in a TrajectorySample
+enum Column {
+    COL_NONE, COL_TIME_S, COL_MICROS, COL_LAT, COL_LON, COL_ALT,
+    COL_QW, COL_QX, COL_QY, COL_QZ, COL_AX, COL_AY, COL_AZ,
+    COL_GX, COL_GY, COL_GZ, COL_MX, COL_MY, COL_MZ,
+};
+
+Column columnFor(std::string name) {
+    // Trim and lower-case so "Time, Lat" style headers work too
+    name.erase(0, name.find_first_not_of(" \t\r"));
+    name.erase(name.find_last_not_of(" \t\r") + 1);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)tolower(c); });
+    static const struct { const char* name; Column column; } names[] = {
+        {"time", COL_TIME_S}, {"t", COL_TIME_S}, {"time_s", COL_TIME_S},
+        {"micros", COL_MICROS}, {"time_us", COL_MICROS},
+        {"lat", COL_LAT}, {"lon", COL_LON}, {"alt", COL_ALT},
+        {"qw", COL_QW}, {"qx", COL_QX}, {"qy", COL_QY}, {"qz", COL_QZ},
+        {"ax", COL_AX}, {"ay", COL_AY}, {"az", COL_AZ},
+        {"gx", COL_GX}, {"gy", COL_GY}, {"gz", COL_GZ},
+        {"mx", COL_MX}, {"my", COL_MY}, {"mz", COL_MZ},
+    };
+    for (const auto& entry : names) {
+        if (name == entry.name) return entry.column;
+    }
+    return COL_NONE;
+}
+
+void assign(TrajectorySample& s, Column column, double v) {
+    switch (column) {
+        case COL_TIME_S: s.micros = v > 0 ? (uint64_t)llround(v * 1e6) : 0; break;
+        case COL_MICROS: s.micros = v > 0 ? (uint64_t)llround(v) : 0; break;
+        case COL_LAT: s.lat = v; break;
+        case COL_LON: s.lon = v; break;
+        case COL_ALT: s.alt = v; break;
+        case COL_QW: s.q[0] = v; break;
+        case COL_QX: s.q[1] = v; break;
+        case COL_QY: s.q[2] = v; break;
+        case COL_QZ: s.q[3] = v; break;
+        case COL_AX: s.accel[0] = v; break;
+        case COL_AY: s.accel[1] = v; break;
+        case COL_AZ: s.accel[2] = v; break;
+        case COL_GX: s.gyro[0] = v; break;
+        case COL_GY: s.gyro[1] = v; break;
+        case COL_GZ: s.gyro[2] = v; break;
+        case COL_MX: s.mag[0] = v; break;
+        case COL_MY: s.mag[1] = v; break;
+        case COL_MZ: s.mag[2] = v; break;
+        case COL_NONE: break;
+    }
+}
+
+bool hasTime(const std::vector<Column>& columns) {
+    return std::find(columns.begin(), columns.end(), COL_TIME_S) != columns.end() ||
+           std::find(columns.begin(), columns.end(), COL_MICROS) != columns.end();
+}
+
+bool hasMagColumns(const std::vector<Column>& columns) {
+    return std::find(columns.begin(), columns.end(), COL_MX) != columns.end();
+}
+
+} // namespace
+
+bool TrajectorySource::load(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        fprintf(stderr, "TrajectorySource: cannot open %s\n", path.c_str());
+        return false;
+    }
+    uint8_t magic[sizeof(BinarySchema::MAGIC)] = {};
+    size_t got = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+    bool binary = got == sizeof(magic) && memcmp(magic, BinarySchema::MAGIC, sizeof(magic)) == 0;
+    return binary ? loadBinary(path) : loadCsv(path);
+}
+
+bool TrajectorySource::loadCsv(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "TrajectorySource: cannot open %s\n", path.c_str());
+        return false;
+    }
+    clear();
+    std::vector<Column> columns;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        if (columns.empty()) {
+            std::stringstream header(line);
+            std::string name;
+            while (std::getline(header, name, ',')) columns.push_back(columnFor(name));
+            if (!hasTime(columns)) {
+                fprintf(stderr, "TrajectorySource: %s has no time or micros column\n", path.c_str());
+                return false;
+            }
+            _hasMag = hasMagColumns(columns);
+            continue;
+        }
+        TrajectorySample sample;
+        const char* p = line.c_str();
+        for (size_t i = 0; i < columns.size() && *p; i++) {
+            if (*p == ',') {  // Empty field keeps the default
+                p++;
+                continue;
+            }
+            char* end;
+            double v = strtod(p, &end);
+            if (end == p) {
+                fprintf(stderr, "TrajectorySource: %s:%zu: bad number in column %zu\n", path.c_str(), lineNumber, i + 1);
+                return false;
+            }
+            assign(sample, columns[i], v);
+            p = end;
+            while (*p == ' ' || *p == '\t') p++;
+            if (*p == ',') p++;
+        }
+        addSample(sample);
+    }
+    return !_samples.empty();
+}
+
+bool TrajectorySource::loadBinary(const std::string& path) {
+    BinaryLogReader reader(path);
+    if (!reader.ok()) return false;
+    const BinarySchema& schema = reader.schema();
+    std::vector<Column> columns;
+    for (const BinaryField& field : schema.fields()) columns.push_back(columnFor(field.name));
+    if (!hasTime(columns)) {
+        fprintf(stderr, "TrajectorySource: %s has no time or micros field\n", path.c_str());
+        return false;
+    }
+    clear();
+    _hasMag = hasMagColumns(columns);
+    _samples.resize((size_t)reader.rows());
+    // Column at a time: a sequential scan per field
+    for (size_t c = 0; c < columns.size(); c++) {
+        if (columns[c] == COL_NONE) continue;
+        size_t row = 0;
+        Column column = columns[c];
+        if (column == COL_MICROS) {
+            reader.scan<uint64_t>((int)c, [&](uint64_t v) { _samples[row++].micros = v; });
+        } else {
+            reader.scan<double>((int)c, [&](double v) { assign(_samples[row++], column, v); });
+        }
+    }
+    for (size_t i = 1; i < _samples.size(); i++) {
+        if (_samples[i].micros < _samples[i - 1].micros) {
+            fprintf(stderr, "TrajectorySource: %s goes back in time at row %zu\n", path.c_str(), i);
+            clear();
+            return false;
+        }
+    }
+    return !_samples.empty();
+}
+
+void TrajectorySource::addSample(const TrajectorySample& sample) {
+    if (!_samples.empty() && sample.micros < _samples.back().micros) {
+        fprintf(stderr, "TrajectorySource: sample at %llu us is older than the previous one, ignored\n",
+                (unsigned long long)sample.micros);
+        return;
+    }
+    _samples.push_back(sample);
+    _currentAt = UINT64_MAX;
+}
+
+void TrajectorySource::clear() {
+    _samples.clear();
+    _cursor = 0;
+    _hasMag = false;
+    _currentAt = UINT64_MAX;
+}
+
+void TrajectorySource::setStartMicros(uint64_t start) {
+    _start = start;
+    _currentAt = UINT64_MAX;
+}
+
+bool TrajectorySource::finished(uint64_t nowMicros) const {
+    return nowMicros >= _start && nowMicros - _start > durationMicros();
+}
+
+void TrajectorySource::setEarthField(double north, double east, double down) {
+    _field[0] = north;
+    _field[1] = east;
+    _field[2] = down;
+    _currentAt = UINT64_MAX;
+}
+
+const TrajectorySample& TrajectorySource::now() {
+    return at(micros());
+}
+
+const TrajectorySample& TrajectorySource::at(uint64_t nowMicros) {
+    if (nowMicros == _currentAt) return _current;
+    _currentAt = nowMicros;
+    if (_samples.empty()) {
+        _current = TrajectorySample();
+        return _current;
+    }
+    uint64_t t = nowMicros > _start ? nowMicros - _start : 0;
+    if (t < _samples[_cursor].micros) {
+        // Clock went backwards (or a new start time): search instead of walking
+        auto it = std::upper_bound(_samples.begin(), _samples.end(), t,
+                                   [](uint64_t v, const TrajectorySample& s) { return v < s.micros; });
+        _cursor = it == _samples.begin() ? 0 : (size_t)(it - _samples.begin()) - 1;
+    }
+    while (_cursor + 1 < _samples.size() && _samples[_cursor + 1].micros <= t) _cursor++;
+
+    const TrajectorySample& a = _samples[_cursor];
+    if (_cursor + 1 == _samples.size() || t <= a.micros) {
+        _current = a;
+    } else {
+        const TrajectorySample& b = _samples[_cursor + 1];
+        interpolate(a, b, (double)(t - a.micros) / (double)(b.micros - a.micros));
+    }
+    _current.micros = t;
+    if (!_hasMag) bodyField(_current, _current.mag);
+    return _current;
+}
+
+void TrajectorySource::interpolate(const TrajectorySample& a, const TrajectorySample& b, double f) {
+    TrajectorySample& s = _current;
+    s.lat = a.lat + (b.lat - a.lat) * f;
+    s.lon = a.lon + (b.lon - a.lon) * f;
+    s.alt = a.alt + (b.alt - a.alt) * f;
+    for (int i = 0; i < 3; i++) {
+        s.accel[i] = a.accel[i] + (b.accel[i] - a.accel[i]) * f;
+        s.gyro[i] = a.gyro[i] + (b.gyro[i] - a.gyro[i]) * f;
+        s.mag[i] = a.mag[i] + (b.mag[i] - a.mag[i]) * f;
+    }
+    // Normalised lerp along the shorter arc; close to slerp at profile rates
+    double dot = a.q[0] * b.q[0] + a.q[1] * b.q[1] + a.q[2] * b.q[2] + a.q[3] * b.q[3];
+    double sign = dot < 0 ? -1.0 : 1.0;
+    double norm = 0;
+    for (int i = 0; i < 4; i++) {
+        s.q[i] = a.q[i] + (sign * b.q[i] - a.q[i]) * f;
+        norm += s.q[i] * s.q[i];
+    }
+    norm = sqrt(norm);
+    if (norm > 0) {
+        for (int i = 0; i < 4; i++) s.q[i] /= norm;
+    }
+}
+
+void TrajectorySource::bodyField(const TrajectorySample& sample, double out[3]) const {
+    // out = R(q)^T * field, with R rotating body vectors into NED
+    double w = sample.q[0], x = sample.q[1], y = sample.q[2], z = sample.q[3];
+    double r[3][3] = {
+        {1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y)},
+        {2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x)},
+        {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)},
+    };
+    for (int i = 0; i < 3; i++) {
+        out[i] = r[0][i] * _field[0] + r[1][i] * _field[1] + r[2][i] * _field[2];
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * One point of a flight profile
+ *
+ * Attitude is the rotation from the body frame to NED. accel is what an
+ * accelerometer on the vehicle reads (specific force, body frame), gyro the
+ * body rates.
+ */
+struct TrajectorySample
+{
+    uint64_t micros = 0;                 // Since the start of the profile
+    double lat = 0, lon = 0;             // Degrees
+    double alt = 0;                      // Metres above sea level
+    double q[4] = {1, 0, 0, 0};          // w, x, y, z
+    double accel[3] = {0, 0, -9.81};
+    double gyro[3] = {0, 0, 0};
+    double mag[3] = {0, 0, 0};           // Body frame, only if the profile has mx/my/mz
+};
+
+/**
+ * TrajectorySource: Flight profile replayed against the mock clock
+ *
+ * Loaded once from CSV or from a BinaryLog file (see BinaryLog.h), then
+ * replayed by the fake sensors in UnitTestSensors.h: given a profile with
+ * setTrajectory(), every read() samples it at micros(), so a whole flight
+ * runs through the real sensor update() paths without per-step test code.
+ *
+ * Columns are matched by name and may come in any order; missing ones keep
+ * the TrajectorySample defaults:
+ *   time (seconds) or micros, lat, lon, alt, qw, qx, qy, qz,
+ *   ax, ay, az, gx, gy, gz, mx, my, mz
+ * Without mx/my/mz the body-frame magnetic field is the earth field rotated
+ * by the attitude. CSV files need a header line; lines starting with '#'
+ * are skipped.
+ *
+ * Samples are interpolated linearly (attitude by normalised lerp). A cursor
+ * follows the clock, so sampling a monotonic clock is O(1) per call; going
+ * back in time falls back to a binary search. Before the first sample and
+ * after the last the end points are held.
+ */
+class TrajectorySource
+{
+public:
+    TrajectorySource() = default;
+
+    /**
+     * Load a CSV or BinaryLog profile (detected by its header)
+     * @return false if the file cannot be read or has no time column
+     */
+    bool load(const std::string& path);
+    bool loadCsv(const std::string& path);
+    bool loadBinary(const std::string& path);
+
+    /**
+     * Append a sample; times must not decrease
+     */
+    void addSample(const TrajectorySample& sample);
+
+    void clear();
+
+    size_t size() const { return _samples.size(); }
+    const std::vector<TrajectorySample>& samples() const { return _samples; }
+    uint64_t durationMicros() const { return _samples.empty() ? 0 : _samples.back().micros; }
+
+    /**
+     * micros() value at which the profile starts (0 by default)
+     */
+    void setStartMicros(uint64_t start);
+    uint64_t startMicros() const { return _start; }
+
+    /**
+     * True once the clock is past the last sample
+     */
+    bool finished(uint64_t nowMicros) const;
+
+    /**
+     * Earth magnetic field in NED, used when the profile has no mx/my/mz
+     */
+    void setEarthField(double north, double east, double down);
+
+    bool hasMag() const { return _hasMag; }
+
+    /**
+     * The profile interpolated at a clock time (cached for repeated calls)
+     */
+    const TrajectorySample& at(uint64_t nowMicros);
+
+    /**
+     * at(micros())
+     */
+    const TrajectorySample& now();
+
+    /**
+     * Magnetic field in the body frame for a sample
+     */
+    void bodyField(const TrajectorySample& sample, double out[3]) const;
+
+private:
+    void interpolate(const TrajectorySample& a, const TrajectorySample& b, double f);
+
+    std::vector<TrajectorySample> _samples;
+    size_t _cursor = 0;
+    uint64_t _start = 0;
+    bool _hasMag = false;
+    double _field[3] = {20.0, 0.0, 45.0};  // Mid-latitude field, uT
+
+    TrajectorySample _current;
+    uint64_t _currentAt = UINT64_MAX;
+};
+
+#endif // TRAJECTORY_H
@@ -12,17 +12,62 @@
 #include <Sensors/Sensor.h>
 #include <Math/Vector.h>
 #include <Math/Quaternion.h>
+#include "Atmosphere.h"
+#include "SensorNoise.h"
+#include "Trajectory.h"
+#include <algorithm>
+#include <cmath>
 
 using namespace astra;
 
-class FakeBarometer : public Barometer
+// Flight profile input of the fakes (see TrajectorySource)
+struct FakeTrajectory
+{
+    TrajectorySource *_trajectory = nullptr;
+
+    void setTrajectory(TrajectorySource *trajectory) { _trajectory = trajectory; }
+
+    // The profile at micros(), or nullptr if none is set
+    const TrajectorySample *trajectoryNow() const { return _trajectory ? &_trajectory->now() : nullptr; }
+};
+
+// Error model applied by a fake's read(); the true value it holds is kept
+struct FakeNoise
+{
+    SensorNoise _noise;
+
+    explicit FakeNoise(const char *stream) : _noise(stream) {}
+
+    void setNoise(const NoiseParams &params, uint64_t seed) { _noise.configure(params, seed); }
+
+    // Seeded with SensorNoise::instanceSeed(), so several live fakes of one
+    // class (redundant sensors) get independent noise streams
+    void setNoise(const NoiseParams &params) { _noise.configure(params); }
+};
+
+// A TrajectorySample vector field as a Vector<3>
+inline Vector<3> toVector(const double v[3])
+{
+    return Vector<3>(v[0], v[1], v[2]);
+}
+
+// A sensor sample of a true vector, through a noise model
+inline Vector<3> applyNoise(SensorNoise &noise, Vector<3> truth)
+{
+    double values[3] = {truth[0], truth[1], truth[2]};
+    noise.apply(values, 3);
+    return Vector<3>(values[0], values[1], values[2]);
+}
+
+// setNoise() models the pressure output, in Pa
+class FakeBarometer : public Barometer, public FakeTrajectory, public FakeNoise
 {
 public:
     bool _healthy = true;
     double _altitude = 0.0;
     bool _shouldFailInit = false;
 
-    FakeBarometer() : Barometer(), fakeAlt(0), fakeAltSet(false)
+    FakeBarometer() : Barometer(), FakeNoise("FakeBarometer"), fakeAlt(0), fakeAltSet(false)
     {
         setName("FakeBarometer");
     }
@@ -35,7 +80,13 @@ public:
 
     int read() override
     {
-        pressure = fakeP;
+        if (const TrajectorySample *s = trajectoryNow()) {
+            // Pressure, so update() derives the altitude like with real hardware
+            fakeP = Atmosphere::pressure(s->alt);
+            fakeT = Atmosphere::temperatureC(s->alt);
+            fakeAltSet = false;
+        }
+        pressure = _noise.enabled() ? _noise.apply(fakeP) : fakeP;
         temp = fakeT;
         healthy = _healthy;  // Update health status when reading
         return 0;
@@ -49,6 +100,9 @@ public:
         // Only calculate altitude from pressure if it wasn't set directly
         if (!fakeAltSet) {
             altitudeASL = calcAltitude(pressure);
+        } else if (_noise.enabled()) {
+            // Pressure noise shows up in the altitude as it would on hardware
+            altitudeASL = fakeAlt + calcAltitude(pressure) - calcAltitude(fakeP);
         }
         // If altitude was set directly, altitudeASL is already correct
         return 0;
@@ -60,9 +114,9 @@ public:
         fakeAlt = altM;
         _altitude = altM;
         fakeAltSet = true;
-        // Calculate corresponding pressure for consistency
-        fakeP = 101325.0 * pow(1.0 - altM / 44330.0, 5.255);
-        fakeT = 15.0 - altM * 0.0065;
+        // ISA pressure and temperature for consistency (valid to 86 km)
+        fakeP = Atmosphere::pressure(altM);
+        fakeT = Atmosphere::temperatureC(altM);
         pressure = fakeP;
         temp = fakeT;
         // Directly set the altitude in the base class
@@ -95,12 +149,15 @@ public:
     int fakeAltSet = false;
 };
 
-class FakeGPS : public GPS
+class FakeGPS : public GPS, public FakeTrajectory
 {
 public:
     bool _healthy = true;
     bool _hasFix = false;
     bool _shouldFailInit = false;
+    SensorNoise _horizontalNoise{"FakeGPS"};  // North/east error in metres
+    SensorNoise _verticalNoise{"FakeGPS.vertical"};
+    double _truth[3] = {0, 0, 0};  // Position before noise
 
     FakeGPS() : GPS()
     {
@@ -116,15 +173,41 @@ public:
     int read() override {
         // Don't override fixQual or hasFix - they may have been set by test code
         // GPS::update() will handle the hasFix logic based on fixQual
+        if (const TrajectorySample *s = trajectoryNow())
+            set(s->lat, s->lon, s->alt);
+        if (_horizontalNoise.enabled() || _verticalNoise.enabled()) {
+            double error[2] = {0, 0};
+            _horizontalNoise.apply(error, 2);
+            const double metresPerDegree = 111320.0;
+            // Clamped so the east error stays finite at the poles
+            double cosLat = std::max(cos(_truth[0] * M_PI / 180.0), 1e-6);
+            position.x() = _truth[0] + error[0] / metresPerDegree;
+            position.y() = _truth[1] + error[1] / (metresPerDegree * cosLat);
+            position.z() = _verticalNoise.enabled() ? _verticalNoise.apply(_truth[2]) : _truth[2];
+        }
         healthy = _healthy;  // Update health status when reading
         return 0;
     }
     void set(double lat, double lon, double alt)
     {
-        position.x() = lat;
-        position.y() = lon;
-        position.z() = alt;
+        position.x() = _truth[0] = lat;
+        position.y() = _truth[1] = lon;
+        position.z() = _truth[2] = alt;
+    }
+
+    // Error models for the fix: horizontal (north, east) and vertical, in metres
+    void setNoise(const NoiseParams &horizontal, const NoiseParams &vertical, uint64_t seed)
+    {
+        _horizontalNoise.configure(horizontal, seed);
+        _verticalNoise.configure(vertical, seed + 1);
+    }
+    // Each seeded with its own SensorNoise::instanceSeed()
+    void setNoise(const NoiseParams &horizontal, const NoiseParams &vertical)
+    {
+        _horizontalNoise.configure(horizontal);
+        _verticalNoise.configure(vertical);
     }
+
     void setHeading(double h)
     {
         heading = h;
@@ -168,14 +251,14 @@ public:
     bool isHealthy() const override { return _healthy; }
 };
 
-class FakeAccel : public Accel
+class FakeAccel : public Accel, public FakeTrajectory, public FakeNoise
 {
 public:
     bool _healthy = true;
     Vector<3> _reading = Vector<3>(0, 0, -9.81);  // Match test expectations
     bool _shouldFailInit = false;
 
-    FakeAccel() : Accel("FakeAccel")
+    FakeAccel() : Accel("FakeAccel"), FakeNoise("FakeAccel")
     {
     }
     ~FakeAccel() {}
@@ -194,7 +277,9 @@ public:
 
     int read() override
     {
-        acc = _reading;
+        if (const TrajectorySample *s = trajectoryNow())
+            _reading = toVector(s->accel);
+        acc = _noise.enabled() ? applyNoise(_noise, _reading) : _reading;
         healthy = _healthy;  // Update health status when reading
         return 0;
     }
@@ -213,14 +298,14 @@ public:
     }
 };
 
-class FakeGyro : public Gyro
+class FakeGyro : public Gyro, public FakeTrajectory, public FakeNoise
 {
 public:
     bool _healthy = true;
     Vector<3> _reading = Vector<3>(0, 0, 0);
     bool _shouldFailInit = false;
 
-    FakeGyro() : Gyro("FakeGyro")
+    FakeGyro() : Gyro("FakeGyro"), FakeNoise("FakeGyro")
     {
     }
     ~FakeGyro() {}
@@ -239,7 +324,9 @@ public:
 
     int read() override
     {
-        angVel = _reading;
+        if (const TrajectorySample *s = trajectoryNow())
+            _reading = toVector(s->gyro);
+        angVel = _noise.enabled() ? applyNoise(_noise, _reading) : _reading;
         healthy = _healthy;  // Update health status when reading
         return 0;
     }
@@ -258,14 +345,14 @@ public:
     }
 };
 
-class FakeMag : public Mag
+class FakeMag : public Mag, public FakeTrajectory, public FakeNoise
 {
 public:
     bool _healthy = true;
     Vector<3> _reading = Vector<3>(0, 0, 0);  // Default to zero
     bool _shouldFailInit = false;
 
-    FakeMag() : Mag("FakeMag")
+    FakeMag() : Mag("FakeMag"), FakeNoise("FakeMag")
     {
     }
     ~FakeMag() {}
@@ -284,7 +371,9 @@ public:
 
     int read() override
     {
-        mag = _reading;
+        if (const TrajectorySample *s = trajectoryNow())
+            _reading = toVector(s->mag);
+        mag = _noise.enabled() ? applyNoise(_noise, _reading) : _reading;
         healthy = _healthy;  // Update health status when reading
         return 0;
     }
@@ -303,7 +392,7 @@ public:
     }
 };
 
-class FakeIMU : public IMU6DoF
+class FakeIMU : public IMU6DoF, public FakeTrajectory
 {
 public:
     FakeIMU() : IMU6DoF("FakeIMU")
@@ -322,6 +411,10 @@ public:
 
     int read() override
     {
+        if (const TrajectorySample *s = trajectoryNow()) {
+            acc = toVector(s->accel);
+            angVel = toVector(s->gyro);
+        }
         return 0;
     }
 
@@ -338,7 +431,7 @@ public:
     }
 };
 
-class FakeIMU9DoF : public IMU9DoF
+class FakeIMU9DoF : public IMU9DoF, public FakeTrajectory
 {
 public:
     FakeIMU9DoF() : IMU9DoF("FakeIMU9DoF")
@@ -358,6 +451,11 @@ public:
 
     int read() override
     {
+        if (const TrajectorySample *s = trajectoryNow()) {
+            acc = toVector(s->accel);
+            angVel = toVector(s->gyro);
+            mag = toVector(s->mag);
+        }
         return 0;
     }
 
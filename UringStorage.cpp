@@ -0,0 +1,573 @@
+#ifdef __linux__
+
+#include "UringStorage.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Raw syscalls: liburing is not required
+static int uringSetup(unsigned entries, io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int uringRegister(int fd, unsigned opcode, const void* arg, unsigned count)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+// UringStorage implementation
+UringStorage::UringStorage(unsigned queueDepth, unsigned buffers, size_t bufferSize, unsigned batchSize)
+    : pool((size_t)buffers * bufferSize), slotSize(bufferSize), batch(batchSize ? batchSize : 1)
+{
+    for (int i = (int)buffers - 1; i >= 0; i--) {
+        freeSlots.push_back(i);
+    }
+
+    unsigned opCount = queueDepth * 2;
+    if (!setupRing(queueDepth)) {
+        int err = errno;
+        teardownRing();
+        fprintf(stderr, "UringStorage: io_uring unavailable (%s), falling back to pwrite\n", strerror(err));
+    }
+    // Never have more operations in flight than the completion ring holds
+    ops.resize(opCount);
+    for (int i = (int)opCount - 1; i >= 0; i--) {
+        freeOps.push_back(i);
+    }
+}
+
+UringStorage::~UringStorage()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    submitLocked(0);
+    while (freeOps.size() < ops.size() && ringFd >= 0) {
+        waitForCompletion();
+    }
+    teardownRing();
+}
+
+bool UringStorage::setupRing(unsigned queueDepth)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = uringSetup(queueDepth, &params);
+    if (fd < 0) {
+        return false;
+    }
+    ringFd = fd;
+    sqEntries = params.sq_entries;
+
+    sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap) {
+        sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+    }
+
+    void* sq = mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        return false;
+    }
+    sqRing = sq;
+    if (singleMap) {
+        cqRing = sqRing;
+    } else {
+        void* cq = mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            return false;
+        }
+        cqRing = cq;
+    }
+    sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqeArea = sqes;
+
+    uint8_t* sqBase = (uint8_t*)sqRing;
+    uint8_t* cqBase = (uint8_t*)cqRing;
+    sqHead = (unsigned*)(sqBase + params.sq_off.head);
+    sqTail = (unsigned*)(sqBase + params.sq_off.tail);
+    sqMask = (unsigned*)(sqBase + params.sq_off.ring_mask);
+    sqArray = (unsigned*)(sqBase + params.sq_off.array);
+    cqHead = (unsigned*)(cqBase + params.cq_off.head);
+    cqTail = (unsigned*)(cqBase + params.cq_off.tail);
+    cqMask = (unsigned*)(cqBase + params.cq_off.ring_mask);
+    cqes = cqBase + params.cq_off.cqes;
+    localTail = submittedTail = *sqTail;
+
+    // Register the pool so reads and writes can use the _FIXED opcodes
+    size_t slots = pool.size() / slotSize;
+    std::vector<iovec> iov(slots);
+    for (size_t i = 0; i < slots; i++) {
+        iov[i].iov_base = slotData((int)i);
+        iov[i].iov_len = slotSize;
+    }
+    if (uringRegister(fd, IORING_REGISTER_BUFFERS, iov.data(), (unsigned)slots) < 0) {
+        return false;
+    }
+    return true;
+}
+
+void UringStorage::teardownRing()
+{
+    if (sqeArea) munmap(sqeArea, sqeBytes);
+    if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingBytes);
+    if (sqRing) munmap(sqRing, sqRingBytes);
+    sqeArea = sqRing = cqRing = nullptr;
+    if (ringFd >= 0) {
+        ::close(ringFd);
+        ringFd = -1;
+    }
+}
+
+int UringStorage::acquireSlot()
+{
+    reap();
+    while (freeSlots.empty()) {
+        if (freeOps.size() == ops.size()) {
+            // Nothing in flight will return one: every buffer is held by an open file
+            fprintf(stderr, "UringStorage: all %zu buffers are held by open files\n", pool.size() / slotSize);
+            return -1;
+        }
+        stallCount++;
+        waitForCompletion();
+    }
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+}
+
+void UringStorage::releaseSlot(int slot)
+{
+    freeSlots.push_back(slot);
+}
+
+void* UringStorage::nextEntry(int& opIndex)
+{
+    while (freeOps.empty()) {
+        waitForCompletion();
+    }
+    opIndex = freeOps.back();
+    freeOps.pop_back();
+    if (ringFd < 0) {
+        return nullptr;
+    }
+
+    // The kernel consumes entries during io_uring_enter, so one submit frees the ring
+    while (localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+        submitLocked(0);
+    }
+    unsigned index = localTail & *sqMask;
+    io_uring_sqe* sqe = (io_uring_sqe*)sqeArea + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    localTail++;
+    return sqe;
+}
+
+void UringStorage::queueWrite(UringFile* file, int slot, size_t length, uint64_t offset)
+{
+    int op;
+    io_uring_sqe* sqe = (io_uring_sqe*)nextEntry(op);
+    ops[op] = Op{file, slot, (uint32_t)length, OP_WRITE};
+    file->_inflight++;
+
+    if (!sqe) {
+        size_t done = 0;
+        int result = 0;
+        while (done < length) {
+            ssize_t n = pwrite(file->_fd, slotData(slot) + done, length - done, (off_t)(offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                result = n < 0 ? -errno : (int)done;
+                break;
+            }
+            done += (size_t)n;
+            result = (int)done;
+        }
+        complete(op, result);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = file->_fd;
+    sqe->addr = (uint64_t)(uintptr_t)slotData(slot);
+    sqe->len = (uint32_t)length;
+    sqe->off = offset;
+    sqe->buf_index = (uint16_t)slot;
+    sqe->user_data = (uint64_t)op;
+    if (localTail - submittedTail >= batch) {
+        submitLocked(0);
+    }
+}
+
+void UringStorage::queueRead(UringFile* file, int slot, uint64_t offset)
+{
+    int op;
+    io_uring_sqe* sqe = (io_uring_sqe*)nextEntry(op);
+    ops[op] = Op{file, slot, (uint32_t)slotSize, OP_READ};
+    file->_inflight++;
+
+    if (!sqe) {
+        ssize_t n;
+        do {
+            n = pread(file->_fd, slotData(slot), slotSize, (off_t)offset);
+        } while (n < 0 && errno == EINTR);
+        complete(op, n < 0 ? -errno : (int)n);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = file->_fd;
+    sqe->addr = (uint64_t)(uintptr_t)slotData(slot);
+    sqe->len = (uint32_t)slotSize;
+    sqe->off = offset;
+    sqe->buf_index = (uint16_t)slot;
+    sqe->user_data = (uint64_t)op;
+    // The reader waits for it, so it goes out with whatever else is queued
+    submitLocked(0);
+}
+
+void UringStorage::queueFsync(UringFile* file)
+{
+    int op;
+    io_uring_sqe* sqe = (io_uring_sqe*)nextEntry(op);
+    ops[op] = Op{file, -1, 0, OP_FSYNC};
+    file->_inflight++;
+
+    if (!sqe) {
+        complete(op, fdatasync(file->_fd) == 0 ? 0 : -errno);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = file->_fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    // Start only after every earlier operation, so it covers the queued writes
+    sqe->flags = IOSQE_IO_DRAIN;
+    sqe->user_data = (uint64_t)op;
+}
+
+void UringStorage::complete(int opIndex, int result)
+{
+    Op& op = ops[opIndex];
+    UringFile* file = op.file;
+    completedCount++;
+
+    switch (op.kind) {
+    case OP_WRITE:
+        if (result != (int)op.length) {
+            if (!file->_failed) {
+                fprintf(stderr, "UringStorage: write failed: %s\n", result < 0 ? strerror(-result) : "short write");
+            }
+            file->_failed = true;
+        }
+        releaseSlot(op.slot);
+        break;
+    case OP_READ:
+        if (result < 0) {
+            fprintf(stderr, "UringStorage: read failed: %s\n", strerror(-result));
+            file->_failed = true;
+        }
+        file->_readLength = result > 0 ? (size_t)result : 0;
+        file->_readPending = false;
+        break;
+    case OP_FSYNC:
+        if (result < 0) {
+            fprintf(stderr, "UringStorage: fdatasync failed: %s\n", strerror(-result));
+            file->_failed = true;
+        }
+        break;
+    }
+
+    file->_inflight--;
+    freeOps.push_back(opIndex);
+}
+
+void UringStorage::submitLocked(unsigned minComplete)
+{
+    if (ringFd < 0) {
+        return;
+    }
+    unsigned toSubmit = localTail - submittedTail;
+    if (toSubmit == 0 && minComplete == 0) {
+        return;
+    }
+    __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+
+    int submitted;
+    do {
+        submitted = uringEnter(ringFd, toSubmit, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0);
+    } while (submitted < 0 && errno == EINTR);
+
+    if (submitted < 0) {
+        // Entries stay in the ring and go out with the next submit
+        if (errno != EAGAIN && errno != EBUSY) {
+            fprintf(stderr, "UringStorage: io_uring_enter failed: %s\n", strerror(errno));
+        }
+        return;
+    }
+    submittedTail += (unsigned)submitted;
+    if (toSubmit) {
+        submitCount++;
+    }
+}
+
+void UringStorage::reap()
+{
+    if (ringFd < 0) {
+        return;
+    }
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        io_uring_cqe* cqe = (io_uring_cqe*)cqes + (head & *cqMask);
+        complete((int)cqe->user_data, cqe->res);
+        head++;
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+}
+
+void UringStorage::waitForCompletion()
+{
+    // The fallback path completes everything synchronously
+    if (ringFd < 0) {
+        return;
+    }
+    uint64_t before = completedCount;
+    reap();
+    if (completedCount == before) {
+        submitLocked(1);
+        reap();
+    }
+}
+
+void UringStorage::submit()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    submitLocked(0);
+    reap();
+}
+
+bool UringStorage::begin() { return pathStorage.begin(); }
+bool UringStorage::end() { return true; }
+bool UringStorage::ok() const { return true; }
+
+astra::IFile* UringStorage::openRead(const char *filename) {
+    std::string path = pathStorage.resolve(filename);
+    int fd = path.empty() ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return new UringFile();
+    }
+    struct stat st;
+    uint64_t size = fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    return new UringFile(this, fd, false, false, size);
+}
+
+astra::IFile* UringStorage::openWrite(const char *filename, bool append) {
+    std::string path = pathStorage.resolve(filename);
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC);
+    int fd = path.empty() ? -1 : open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        return new UringFile();
+    }
+    struct stat st;
+    uint64_t size = fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    return new UringFile(this, fd, true, append, size);
+}
+
+bool UringStorage::exists(const char *filename) { return pathStorage.exists(filename); }
+bool UringStorage::remove(const char *filename) { return pathStorage.remove(filename); }
+bool UringStorage::mkdir(const char *path) { return pathStorage.mkdir(path); }
+bool UringStorage::rmdir(const char *path) { return pathStorage.rmdir(path); }
+
+// UringFile implementation
+UringFile::UringFile() {}
+
+UringFile::UringFile(UringStorage* storage, int fd, bool writable, bool append, uint64_t size)
+    : _storage(storage), _fd(fd), _writable(writable), _append(append), _size(size)
+{
+    _pos = append ? size : 0;
+}
+
+UringFile::~UringFile() {
+    close();
+}
+
+void UringFile::queueFill() {
+    if (_slot < 0) return;
+    if (_fill == 0) {
+        _storage->releaseSlot(_slot);
+    } else {
+        _storage->queueWrite(this, _slot, _fill, _slotOffset);
+    }
+    _slot = -1;
+    _fill = 0;
+}
+
+size_t UringFile::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t UringFile::write(const uint8_t *buffer, size_t size) {
+    if (!_storage || !_writable) return 0;
+    std::lock_guard<std::mutex> guard(_storage->lock);
+    _storage->reap();
+    if (_failed) return 0;
+
+    size_t done = 0;
+    while (done < size) {
+        if (_slot < 0) {
+            _slot = _storage->acquireSlot();
+            if (_slot < 0) break;
+            _fill = 0;
+            _slotOffset = _append ? _size : _pos;
+        }
+        size_t chunk = std::min(_storage->slotSize - _fill, size - done);
+        memcpy(_storage->slotData(_slot) + _fill, buffer + done, chunk);
+        _fill += chunk;
+        done += chunk;
+        _pos = _slotOffset + _fill;
+        if (_pos > _size) _size = _pos;
+        if (_fill == _storage->slotSize) {
+            queueFill();
+        }
+    }
+    return done;
+}
+
+bool UringFile::flush() {
+    if (!_storage) return false;
+    if (!_writable) return true;
+    std::lock_guard<std::mutex> guard(_storage->lock);
+    queueFill();
+    _storage->queueFsync(this);
+    _storage->submitLocked(0);
+    _storage->reap();
+    return !_failed;
+}
+
+bool UringFile::sync() {
+    if (!flush()) return false;
+    std::lock_guard<std::mutex> guard(_storage->lock);
+    while (_inflight > 0) {
+        _storage->waitForCompletion();
+    }
+    return !_failed;
+}
+
+bool UringFile::fillReadBuffer() {
+    if (_pos >= _size) {
+        // Another handle may have appended since we measured
+        struct stat st;
+        if (fstat(_fd, &st) == 0 && (uint64_t)st.st_size > _size) _size = (uint64_t)st.st_size;
+        if (_pos >= _size) return false;
+    }
+    if (_slot < 0) {
+        _slot = _storage->acquireSlot();
+        if (_slot < 0) return false;
+    }
+    _slotOffset = _pos;
+    _readLength = 0;
+    _readPending = true;
+    _storage->queueRead(this, _slot, _pos);
+    while (_readPending) {
+        _storage->waitForCompletion();
+    }
+    return _readLength > 0;
+}
+
+int UringFile::read() {
+    uint8_t b;
+    return readBytes(&b, 1) == 1 ? b : -1;
+}
+
+int UringFile::readBytes(uint8_t *buffer, size_t length) {
+    if (!_storage || _writable) return 0;
+    std::lock_guard<std::mutex> guard(_storage->lock);
+
+    size_t done = 0;
+    while (done < length) {
+        if (_pos < _slotOffset || _pos >= _slotOffset + _readLength) {
+            if (!fillReadBuffer()) break;
+        }
+        size_t within = (size_t)(_pos - _slotOffset);
+        size_t chunk = std::min(length - done, _readLength - within);
+        memcpy(buffer + done, _storage->slotData(_slot) + within, chunk);
+        done += chunk;
+        _pos += chunk;
+    }
+    return (int)done;
+}
+
+int UringFile::available() {
+    if (!_storage) return 0;
+    std::lock_guard<std::mutex> guard(_storage->lock);
+    if (!_writable && _pos >= _size) {
+        struct stat st;
+        if (fstat(_fd, &st) == 0 && (uint64_t)st.st_size > _size) _size = (uint64_t)st.st_size;
+    }
+    return _size > _pos ? (int)(_size - _pos) : 0;
+}
+
+bool UringFile::seek(uint32_t pos) {
+    if (!_storage) return false;
+    std::lock_guard<std::mutex> guard(_storage->lock);
+    // The write buffer covers one contiguous range; append mode always writes at the end
+    if (_writable && !_append && pos != _pos) {
+        queueFill();
+    }
+    _pos = pos;
+    return true;
+}
+
+uint32_t UringFile::position() {
+    return _storage ? (uint32_t)_pos : 0;
+}
+
+uint32_t UringFile::size() {
+    return _storage ? (uint32_t)_size : 0;
+}
+
+bool UringFile::close() {
+    if (!_storage) return false;
+    {
+        std::lock_guard<std::mutex> guard(_storage->lock);
+        if (_writable) {
+            queueFill();
+        }
+        _storage->submitLocked(0);
+        while (_inflight > 0) {
+            _storage->waitForCompletion();
+        }
+        if (_slot >= 0) {
+            _storage->releaseSlot(_slot);
+            _slot = -1;
+        }
+    }
+    bool closed = ::close(_fd) == 0;
+    _fd = -1;
+    _storage = nullptr;
+    return closed && !_failed;
+}
+
+bool UringFile::isOpen() const {
+    return _storage != nullptr;
+}
+
+#endif // __linux__
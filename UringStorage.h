@@ -0,0 +1,205 @@
+#ifndef URING_STORAGE_H
+#define URING_STORAGE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "RecordData/Storage/IStorage.h"
+#include "RecordData/Storage/IFile.h"
+#include "MockStorage.h"
+
+class UringStorage;
+
+/**
+ * UringFile: IFile whose I/O goes through UringStorage's io_uring
+ *
+ * Writes fill a registered buffer; a full buffer is queued as one
+ * WRITE_FIXED at its file offset and write() returns without waiting.
+ * flush() queues the partial buffer plus an fdatasync that runs after every
+ * earlier write, submits, and returns; sync() also waits for them. Reads
+ * fill a registered buffer with READ_FIXED and wait for it, since the
+ * caller needs the data.
+ *
+ * A handle is either for reading (openRead) or writing (openWrite).
+ */
+class UringFile : public astra::IFile
+{
+public:
+    UringFile();  // Not open, like MockFile when fopen fails
+    ~UringFile();
+
+    UringFile(const UringFile&) = delete;
+    UringFile& operator=(const UringFile&) = delete;
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    bool flush() override;  // Non-blocking
+
+    int read() override;
+    int readBytes(uint8_t *buffer, size_t length) override;
+    int available() override;
+
+    bool seek(uint32_t pos) override;
+    uint32_t position() override;
+    uint32_t size() override;
+    bool close() override;  // Waits for this file's outstanding operations
+
+    bool isOpen() const override;
+
+    /**
+     * Flush and wait until every write and flush of this file has completed
+     * @return false if any of them failed
+     */
+    bool sync();
+
+private:
+    friend class UringStorage;
+    UringFile(UringStorage* storage, int fd, bool writable, bool append, uint64_t size);
+
+    void queueFill();
+    bool fillReadBuffer();
+
+    UringStorage* _storage = nullptr;
+    int _fd = -1;
+    bool _writable = false;
+    bool _append = false;
+    bool _failed = false;
+
+    uint64_t _pos = 0;
+    uint64_t _size = 0;
+
+    int _slot = -1;            // Registered buffer being filled or read from
+    size_t _fill = 0;          // Bytes used in the write buffer
+    uint64_t _slotOffset = 0;  // File offset of the buffer's first byte
+    size_t _readLength = 0;    // Valid bytes in the read buffer
+    bool _readPending = false;
+
+    int _inflight = 0;         // Queued operations not yet completed
+};
+
+/**
+ * UringStorage: IStorage doing file I/O through Linux io_uring
+ *
+ * One ring and one pool of registered buffers serve every file opened from
+ * the storage. Operations are queued as submission entries and handed to
+ * the kernel in batches (every batchSize entries, on flush() or when a
+ * buffer is needed), and completions are reaped from the shared completion
+ * ring without a syscall whenever a file is used. The caller only blocks
+ * when every buffer is in flight, or to read.
+ *
+ * If io_uring is not available (old kernel, seccomp) the same files fall
+ * back to pwrite/pread/fdatasync done synchronously; usingUring() tells
+ * which path is active.
+ *
+ * Paths resolve like MockStorage (sandbox roots included). Close every file
+ * before destroying the storage.
+ */
+class UringStorage : public astra::IStorage
+{
+public:
+    static const unsigned DEFAULT_QUEUE_DEPTH = 64;
+    static const unsigned DEFAULT_BUFFERS = 16;
+    static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+    static const unsigned DEFAULT_BATCH = 4;
+
+    explicit UringStorage(unsigned queueDepth = DEFAULT_QUEUE_DEPTH, unsigned buffers = DEFAULT_BUFFERS,
+                          size_t bufferSize = DEFAULT_BUFFER_SIZE, unsigned batchSize = DEFAULT_BATCH);
+    ~UringStorage();
+
+    UringStorage(const UringStorage&) = delete;
+    UringStorage& operator=(const UringStorage&) = delete;
+
+    bool begin() override;
+    bool end() override;
+    bool ok() const override;
+
+    astra::IFile *openRead(const char *filename) override;
+    astra::IFile *openWrite(const char *filename, bool append = true) override;
+
+    bool exists(const char *filename) override;
+    bool remove(const char *filename) override;
+    bool mkdir(const char *path) override;
+    bool rmdir(const char *path) override;
+
+    bool usingUring() const { return ringFd >= 0; }
+
+    /**
+     * Hand every queued operation to the kernel now
+     */
+    void submit();
+
+    MockStorage& paths() { return pathStorage; }
+
+    uint64_t submitCalls() const { return submitCount; }
+    uint64_t completedOps() const { return completedCount; }
+    uint64_t bufferStalls() const { return stallCount; }
+
+private:
+    friend class UringFile;
+
+    enum OpKind : uint8_t { OP_WRITE, OP_READ, OP_FSYNC };
+    struct Op {
+        UringFile* file;
+        int slot;
+        uint32_t length;
+        OpKind kind;
+    };
+
+    bool setupRing(unsigned queueDepth);
+    void teardownRing();
+
+    uint8_t* slotData(int slot) { return pool.data() + (size_t)slot * slotSize; }
+    int acquireSlot();
+    void releaseSlot(int slot);
+
+    void queueWrite(UringFile* file, int slot, size_t length, uint64_t offset);
+    void queueRead(UringFile* file, int slot, uint64_t offset);
+    void queueFsync(UringFile* file);
+    void complete(int opIndex, int result);
+    void* nextEntry(int& opIndex);
+
+    void submitLocked(unsigned minComplete);
+    void reap();
+    void waitForCompletion();
+
+    std::mutex lock;  // Guards the ring, the pool and every file's I/O state
+    MockStorage pathStorage;
+
+    // Buffer pool, registered with the ring
+    std::vector<uint8_t> pool;
+    size_t slotSize;
+    std::vector<int> freeSlots;
+
+    // Operation table indexed by user_data
+    std::vector<Op> ops;
+    std::vector<int> freeOps;
+
+    // Ring state
+    int ringFd = -1;
+    unsigned batch;
+    unsigned sqEntries = 0;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingBytes = 0;
+    size_t cqRingBytes = 0;
+    void* sqeArea = nullptr;
+    size_t sqeBytes = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    void* cqes = nullptr;
+    unsigned localTail = 0;     // Entries prepared
+    unsigned submittedTail = 0; // Entries handed to the kernel
+
+    uint64_t submitCount = 0;
+    uint64_t completedCount = 0;
+    uint64_t stallCount = 0;
+};
+
+#endif // URING_STORAGE_H
@@ -0,0 +1,70 @@
+#ifndef WAKE_SIGNAL_H
+#define WAKE_SIGNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * WakeSignal: Timed sleep for a consumer thread that producers can cut short
+ *
+ * The consumer drains its queue and then calls sleep(), which waits for the
+ * period unless woken earlier. Producers that have queued enough to be worth
+ * an early start call wakeIfIdle(): only the first of them after the
+ * consumer went idle takes the lock and notifies, the others see the flag
+ * already cleared and pay one atomic load. Trickles are left to the timer.
+ *
+ * No wakeup is lost: sleep() sets the idle flag and checks its condition
+ * with the lock held, and keeps holding it until wait() releases it, while
+ * wake() notifies under the same lock.
+ *
+ * lock() is exposed so the owner can guard its own consumer-side state (and
+ * condition variables of its own) with the same mutex.
+ */
+class WakeSignal
+{
+public:
+    std::mutex& lock() { return mutex; }
+
+    /**
+     * Wake the consumer now
+     */
+    void wake()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        cv.notify_one();
+    }
+
+    /**
+     * Wake the consumer if it is sleeping and nobody has woken it yet
+     */
+    void wakeIfIdle()
+    {
+        if (idle.load() && idle.exchange(false)) {
+            wake();
+        }
+    }
+
+    /**
+     * Sleep for up to period, unless stillIdle() (called with lock() held)
+     * says there is already work
+     */
+    template <typename Condition>
+    void sleep(std::chrono::milliseconds period, Condition stillIdle)
+    {
+        std::unique_lock<std::mutex> guard(mutex);
+        idle.store(true);
+        if (stillIdle()) {
+            cv.wait_for(guard, period);
+        }
+        idle.store(false);
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> idle{false};
+};
+
+#endif // WAKE_SIGNAL_H
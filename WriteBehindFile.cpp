@@ -0,0 +1,183 @@
+#include "WriteBehindFile.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Push data already handed to the OS on to the storage device
+static bool syncToDisk(FILE* file) {
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#elif defined(__linux__)
+    return fdatasync(fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+WriteBehindFile::WriteBehindFile(const char* filename, bool append, size_t bufferSize)
+    : _capacity(bufferSize ? bufferSize : DEFAULT_BUFFER_SIZE)
+{
+    _file = fopen(filename, append ? "ab" : "wb");
+    if (!_file) return;
+
+    if (append) {
+        fseek(_file, 0, SEEK_END);
+        long end = ftell(_file);
+        _baseSize = end > 0 ? (uint64_t)end : 0;
+    }
+    _front.reserve(_capacity);
+    _back.reserve(_capacity);
+    _writer = std::thread(&WriteBehindFile::writerLoop, this);
+}
+
+WriteBehindFile::~WriteBehindFile() {
+    close();
+}
+
+void WriteBehindFile::writerLoop() {
+    std::unique_lock<std::mutex> lk(_lock);
+    for (;;) {
+        _wake.wait(lk, [this] {
+            return _backBusy || _flushTarget > _flushed || _syncTarget > _synced || _closing;
+        });
+
+        // A flush or close also takes the partially filled front buffer
+        if (!_backBusy && !_front.empty() && (_flushTarget > _written || _closing)) {
+            _front.swap(_back);
+            _backBusy = true;
+        }
+
+        if (_backBusy) {
+            lk.unlock();
+            size_t n = fwrite(_back.data(), 1, _back.size(), _file);
+            lk.lock();
+            if (n != _back.size() && !_failed) {
+                fprintf(stderr, "WriteBehindFile: write failed after %llu bytes\n",
+                        (unsigned long long)(_written + n));
+                _failed = true;
+            }
+            _written += _back.size();
+            _back.clear();
+            _backBusy = false;
+            _drained.notify_all();
+            continue;
+        }
+
+        if (_flushTarget > _flushed || _syncTarget > _synced || _closing) {
+            uint64_t target = _written;
+            bool durable = _syncTarget > _synced;
+            lk.unlock();
+            bool flushed = fflush(_file) == 0;
+            if (flushed && durable) flushed = syncToDisk(_file);
+            lk.lock();
+            if (!flushed) _failed = true;
+            _flushed = target;
+            if (durable) _synced = target;
+            _drained.notify_all();
+        }
+
+        if (_closing) return;
+    }
+}
+
+size_t WriteBehindFile::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t WriteBehindFile::write(const uint8_t *buffer, size_t size) {
+    std::unique_lock<std::mutex> lk(_lock);
+    if (!_file || _failed || _closing) return 0;
+
+    size_t done = 0;
+    while (done < size) {
+        size_t room = _capacity - _front.size();
+        if (room == 0) {
+            if (_backBusy) {
+                // The writer fell behind: this is the only place write() blocks
+                _stalls++;
+                _drained.wait(lk, [this] { return !_backBusy; });
+            }
+            _front.swap(_back);
+            _backBusy = true;
+            _wake.notify_one();
+            continue;
+        }
+        size_t n = std::min(room, size - done);
+        _front.insert(_front.end(), buffer + done, buffer + done + n);
+        done += n;
+        _accepted += n;
+    }
+    return done;
+}
+
+bool WriteBehindFile::flush() {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_file) return false;
+    _flushTarget = _accepted;
+    _wake.notify_one();
+    return !_failed;
+}
+
+bool WriteBehindFile::sync() {
+    std::unique_lock<std::mutex> lk(_lock);
+    if (!_file) return false;
+    uint64_t target = _accepted;
+    _flushTarget = target;
+    _syncTarget = target;
+    _wake.notify_one();
+    _drained.wait(lk, [this, target] { return _synced >= target || _closing; });
+    return !_failed && _synced >= target;
+}
+
+int WriteBehindFile::read() {
+    return -1;
+}
+
+int WriteBehindFile::readBytes(uint8_t *, size_t) {
+    return 0;
+}
+
+int WriteBehindFile::available() {
+    return 0;
+}
+
+bool WriteBehindFile::seek(uint32_t) {
+    return false;
+}
+
+uint32_t WriteBehindFile::position() {
+    return size();
+}
+
+uint32_t WriteBehindFile::size() {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_file) return 0;
+    return (uint32_t)(_baseSize + _accepted);
+}
+
+uint64_t WriteBehindFile::stalls() {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stalls;
+}
+
+bool WriteBehindFile::close() {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_file || _closing) return false;
+        _closing = true;
+        _wake.notify_one();
+    }
+    _writer.join();
+    std::lock_guard<std::mutex> guard(_lock);
+    bool closed = fclose(_file) == 0;
+    _file = nullptr;
+    return closed && !_failed;
+}
+
+bool WriteBehindFile::isOpen() const {
+    return _file != nullptr;
+}
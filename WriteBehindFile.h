@@ -0,0 +1,96 @@
+#ifndef WRITE_BEHIND_FILE_H
+#define WRITE_BEHIND_FILE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RecordData/Storage/IFile.h"
+
+/**
+ * WriteBehindFile: Append-only IFile that writes to disk from a background thread
+ *
+ * Writes are copied into the front of two equally sized buffers. When it
+ * fills, the buffers swap and a writer thread drains the full one to disk
+ * while the caller keeps appending, so logging from loop() never waits on
+ * a syscall. It only blocks if the writer is still busy with the other
+ * buffer when the front fills again; stalls() counts those waits, so a
+ * non-zero value means the buffers are too small for the log rate.
+ *
+ * flush() only asks the writer to push everything written so far to the OS
+ * and returns immediately. sync() is the durability request: the writer
+ * also has the OS write the data to the device (fdatasync), and sync()
+ * waits for that.
+ *
+ * Reading and seeking are not supported.
+ */
+class WriteBehindFile : public astra::IFile
+{
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    /**
+     * @param filename Host path
+     * @param append Keep existing contents instead of truncating
+     * @param bufferSize Size of each of the two buffers
+     */
+    WriteBehindFile(const char* filename, bool append, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    ~WriteBehindFile();
+
+    WriteBehindFile(const WriteBehindFile&) = delete;
+    WriteBehindFile& operator=(const WriteBehindFile&) = delete;
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    bool flush() override;  // Non-blocking
+
+    int read() override;
+    int readBytes(uint8_t *buffer, size_t length) override;
+    int available() override;
+
+    bool seek(uint32_t pos) override;
+    uint32_t position() override;
+    uint32_t size() override;
+    bool close() override;  // Drains both buffers
+
+    bool isOpen() const override;
+
+    /**
+     * Flush and wait until everything written so far is on the device
+     * @return false if a write to disk or the sync failed
+     */
+    bool sync();
+
+    uint64_t stalls();
+
+private:
+    void writerLoop();
+
+    FILE* _file = nullptr;
+    size_t _capacity;
+    uint64_t _baseSize = 0;   // Length of the file when opened
+
+    std::mutex _lock;
+    std::condition_variable _wake;     // Signals the writer
+    std::condition_variable _drained;  // Signals writers and sync()
+    std::thread _writer;
+
+    std::vector<uint8_t> _front;  // Filled by write()
+    std::vector<uint8_t> _back;   // Handed to the writer thread
+    bool _backBusy = false;
+    bool _closing = false;
+    bool _failed = false;
+
+    uint64_t _accepted = 0;     // Bytes taken by write()
+    uint64_t _written = 0;      // Bytes passed to fwrite
+    uint64_t _flushTarget = 0;  // Bytes requested by flush()
+    uint64_t _flushed = 0;      // Bytes known to be flushed
+    uint64_t _syncTarget = 0;   // Bytes requested by sync()
+    uint64_t _synced = 0;       // Bytes known to be on the device
+    uint64_t _stalls = 0;
+};
+
+#endif // WRITE_BEHIND_FILE_H